@@ -0,0 +1,143 @@
+#include "batch.hpp"
+#include "filters.hpp"
+#include "pid.hpp"
+#include "utilities.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+
+#define INPUT_ROWS 64   // Distinct input rows cycled through by the steps
+
+
+/**
+ * @brief Runs the filter and PID of every instance with the scalar types.
+ * @return The elapsed time in nanoseconds.
+*/
+uint64_t runScalar(size_t count, int steps, const std::vector<float>& inputs, std::vector<float>& outputs);
+
+/**
+ * @brief Runs the filter and PID of every instance with the batch types.
+ * @return The elapsed time in nanoseconds.
+*/
+uint64_t runBatch(size_t count, int steps, const std::vector<float>& inputs, std::vector<float>& outputs);
+
+/**
+ * @brief Gets the parameters of an instance (a spread of tunings, as in a sweep).
+*/
+void tuning(size_t index, float& alpha, float& kp, float& ki, float& kd);
+
+
+
+int main(int argc, char** argv) {
+
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1024;
+    int steps = (argc > 2) ? atoi(argv[2]) : 10000;
+
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0.0f, 0.5f);
+
+    std::vector<float> inputs(INPUT_ROWS * count);
+
+    for (float& input : inputs) {
+        input = noise(generator);
+    }
+
+    std::vector<float> scalar(count);
+    std::vector<float> batch(count);
+
+    uint64_t scalar_ns = runScalar(count, steps, inputs, scalar);
+    uint64_t batch_ns = runBatch(count, steps, inputs, batch);
+
+    // Bit-compatible: the last responses of every instance must be identical
+    bool identical = memcmp(scalar.data(), batch.data(), count * sizeof(float)) == 0;
+
+    double updates = (double) count * steps;
+
+    printf("instances %zu, steps %d, isa %s\n", count, steps, batchInstructionSet());
+    printf("scalar: %.3f ns/instance-step, %.1f M instance-steps/s\n", scalar_ns / updates, updates / scalar_ns * 1e3);
+    printf("batch:  %.3f ns/instance-step, %.1f M instance-steps/s\n", batch_ns / updates, updates / batch_ns * 1e3);
+    printf("speedup: %.2fx, bit-compatible: %s\n", (double) scalar_ns / batch_ns, identical ? "yes" : "NO");
+
+    return identical ? 0 : 1;
+
+}
+
+
+void tuning(size_t index, float& alpha, float& kp, float& ki, float& kd) {
+
+    alpha = 0.1f + 0.9f * (index % 10) / 9.0f;
+    kp = 0.5f * (index % 41);
+    ki = 0.1f * (index % 7);
+    kd = 0.05f * (index % 5);
+
+}
+
+
+uint64_t runScalar(size_t count, int steps, const std::vector<float>& inputs, std::vector<float>& outputs) {
+
+    std::vector<FIRFilter> filters(count);
+    std::vector<PIDController> pids(count);
+
+    for (size_t i = 0; i < count; i++) {
+
+        float alpha, kp, ki, kd;
+        tuning(i, alpha, kp, ki, kd);
+
+        filters[i] = FIRFilter(alpha, 0.0f);
+        pids[i] = PIDController(kp, ki, kd, 0.01f);
+
+    }
+
+    uint64_t start = monotonicTime();
+
+    for (int step = 0; step < steps; step++) {
+
+        const float* row = &inputs[(step % INPUT_ROWS) * count];
+
+        for (size_t i = 0; i < count; i++) {
+            outputs[i] = pids[i].pass(0.0f, filters[i].pass(row[i]));
+        }
+
+    }
+
+    return monotonicTime() - start;
+
+}
+
+
+uint64_t runBatch(size_t count, int steps, const std::vector<float>& inputs, std::vector<float>& outputs) {
+
+    BatchFIRFilter filters(count);
+    BatchPIDController pids(count);
+
+    for (size_t i = 0; i < count; i++) {
+
+        float alpha, kp, ki, kd;
+        tuning(i, alpha, kp, ki, kd);
+
+        filters.set(i, alpha, 0.0f);
+        pids.set(i, kp, ki, kd, 0.01f);
+
+    }
+
+    std::vector<float> setpoints(count, 0.0f);
+    std::vector<float> filtered(count);
+
+    uint64_t start = monotonicTime();
+
+    for (int step = 0; step < steps; step++) {
+
+        const float* row = &inputs[(step % INPUT_ROWS) * count];
+
+        filters.pass(row, filtered.data());
+        pids.pass(setpoints.data(), filtered.data(), outputs.data());
+
+    }
+
+    return monotonicTime() - start;
+
+}
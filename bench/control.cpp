@@ -0,0 +1,124 @@
+#include "harness.hpp"
+#include "sim/simbus.hpp"
+#include "picarx.hpp"
+#include "filters.hpp"
+#include "pid.hpp"
+#include "logtable.hpp"
+#include "utilities.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+
+
+#define SENSOR_MASK (ADC_MASK_A0 | ADC_MASK_A3)
+#define SPEED 0.5f
+#define DT 0.01f
+#define ITERATIONS 1000000
+
+
+constexpr LogTable LINE_LOG_TABLE(ADC_VREF / ADC_RESO * LINE_SENSOR_GAIN, LOG_DIFF_BIAS);
+
+volatile float float_sink;
+
+
+/**
+ * @brief Moves the simulated line under the sensors: the codes of A0 and A3 follow a slow random walk.
+*/
+void moveLine(std::mt19937& generator) {
+
+    static float position = 0.0f;
+    static std::normal_distribution<float> step(0.0f, 0.01f);
+
+    position = saturate(0.99f * position + step(generator), -1.0f, 1.0f);
+
+    simBusSetInput(A0, (uint16_t) lroundf(2000.0f * expf(position)));
+    simBusSetInput(A3, 2000);
+
+}
+
+/**
+ * @brief Prints the bus traffic of a benchmark to stderr (not part of the CSV).
+*/
+void printTraffic(const BenchResult& result) {
+
+    SimBusStats stats = simBusGetStats();
+
+    // The counters cover the warm-up and every timed run
+    double operations = (double) result.iterations * (BENCH_REPEATS + 1);
+
+    fprintf(stderr, "# %s: %.2f transactions, %.1f bytes per op\n", result.name, stats.transactions / operations, stats.bytes / operations);
+
+    simBusResetStats();
+
+}
+
+
+
+int main(int argc, char** argv) {
+
+    uint64_t iterations = (argc > 1) ? strtoull(argv[1], NULL, 10) : ITERATIONS;
+
+    // Wire time per byte, 0 measures the software path alone
+    simBusSetByteTime((argc > 2) ? strtoull(argv[2], NULL, 10) : 0);
+
+    std::mt19937 generator(1);
+
+    // Not connected: the bus is simulated and the GPIO lines are never requested
+    PiCarX picarx;
+    FIRFilter filter(0.5f, 0.0f);
+    RobustPIDController pid(10.0f, 0.5f, 0.05f, -30.0f, 30.0f, 0.05f, 0.02f);
+
+    moveLine(generator);
+
+    printBenchHeader();
+
+    BenchResult result = runBench("read_frame", iterations, [&](uint64_t) {
+        SensorFrame frame;
+        picarx.readFrame(SENSOR_MASK, frame);
+    });
+
+    printBenchResult(result);
+    printTraffic(result);
+
+    result = runBench("analog_voltage_pair", iterations, [&](uint64_t) {
+        float_sink = picarx.getAnalogVoltage(A0) - picarx.getAnalogVoltage(A3);
+    });
+
+    printBenchResult(result);
+    printTraffic(result);
+
+    result = runBench("apply_frame", iterations, [&](uint64_t i) {
+        ActuatorFrame command = { SPEED, (float) (i % 61) - 30.0f };
+        picarx.applyActuatorFrame(command);
+    });
+
+    printBenchResult(result);
+    printTraffic(result);
+
+    // The whole cycle of src/main.cpp without the threads: read, log difference, filter, PID, actuate
+    result = runBench("control_cycle", iterations, [&](uint64_t) {
+
+        moveLine(generator);
+
+        SensorFrame frame;
+
+        if (picarx.readFrame(SENSOR_MASK, frame)) {
+
+            float diff = LINE_LOG_TABLE.logdiffRaw(frame.raw[ADC_IDX_A0], frame.raw[ADC_IDX_A3]);
+            float response = pid.pass(0.0f, filter.pass(diff), DT);
+
+            ActuatorFrame command = { SPEED, response };
+            picarx.applyActuatorFrame(command);
+
+        }
+
+    });
+
+    printBenchResult(result);
+    printTraffic(result);
+
+    return 0;
+
+}
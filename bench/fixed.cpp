@@ -0,0 +1,207 @@
+#include "pipeline.hpp"
+#include "fixed.hpp"
+#include "filters.hpp"
+#include "pid.hpp"
+#include "utilities.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+
+#define ALPHA 0.5f              // Tuning exercising every term
+#define KP 10.0f
+#define KI 0.5f
+#define KD 0.05f
+#define DT 0.01f
+#define CYCLES 1000000
+
+// Largest accepted deviations from the float path: half a servo tick in angle (in 16.16, ki * dt is
+// off by 0.1% and the integral drifts accordingly) and one tick of truncation in pulse width
+#define ANGLE_TOLERANCE 0.2
+#define TICK_TOLERANCE 1
+
+
+constexpr LogTable LINE_LOG_TABLE(ADC_VREF / ADC_RESO * LINE_SENSOR_GAIN, LOG_DIFF_BIAS);
+
+
+/**
+ * @brief A recorded-like stream of line sensor codes: the line wanders around the center of the car.
+*/
+struct Codes {
+
+    std::vector<uint16_t> left;
+    std::vector<uint16_t> right;
+
+};
+
+/**
+ * @brief Generates the sensor codes of a wandering line.
+ * @param count The number of cycles.
+ * @return The codes.
+*/
+Codes generate(int count);
+
+/**
+ * @brief Runs the float code of the car (LogTable, FIRFilter, PIDController, steeringPulseWidth).
+ * @param codes The sensor codes.
+ * @param angles Receives the responses.
+ * @param ticks Receives the pulse widths.
+ * @return The elapsed time in nanoseconds.
+*/
+uint64_t runReference(const Codes& codes, std::vector<float>& angles, std::vector<uint16_t>& ticks);
+
+/**
+ * @brief Runs a pipeline instantiation.
+ * @param codes The sensor codes.
+ * @param angles Receives the responses.
+ * @param ticks Receives the pulse widths.
+ * @return The elapsed time in nanoseconds.
+*/
+template <typename T>
+uint64_t runPipeline(const Codes& codes, std::vector<float>& angles, std::vector<uint16_t>& ticks);
+
+/**
+ * @brief Compares a pipeline run against the reference run and prints the result.
+ * @return True if the run is within the tolerances.
+*/
+bool report(const char* name, uint64_t ns, uint64_t reference_ns, const std::vector<float>& angles, const std::vector<uint16_t>& ticks,
+            const std::vector<float>& reference_angles, const std::vector<uint16_t>& reference_ticks);
+
+
+
+int main() {
+
+    Codes codes = generate(CYCLES);
+
+    std::vector<float> reference_angles(CYCLES);
+    std::vector<uint16_t> reference_ticks(CYCLES);
+    std::vector<float> angles(CYCLES);
+    std::vector<uint16_t> ticks(CYCLES);
+
+    uint64_t reference_ns = runReference(codes, reference_angles, reference_ticks);
+
+    printf("reference (float code): %.2f ns/cycle\n", (double) reference_ns / CYCLES);
+
+    bool valid = true;
+
+    uint64_t ns = runPipeline<float>(codes, angles, ticks);
+    valid &= report("pipeline<float>", ns, reference_ns, angles, ticks, reference_angles, reference_ticks);
+
+    ns = runPipeline<Q16_16>(codes, angles, ticks);
+    valid &= report("pipeline<Q16_16>", ns, reference_ns, angles, ticks, reference_angles, reference_ticks);
+
+    return valid ? 0 : 1;
+
+}
+
+
+Codes generate(int count) {
+
+    Codes codes;
+
+    std::mt19937 generator(1);
+    std::normal_distribution<float> step(0.0f, 0.02f);
+
+    float right_volts = PiCarX::toVoltage(ADC_IDX_A3, 2000) * LINE_SENSOR_GAIN;
+    float position = 0.0f;
+
+    for (int i = 0; i < count; i++) {
+
+        // Log difference of the line position, pulled back to the center as the car steers
+        position = saturate(0.99f * position + step(generator), -2.0f, 2.0f);
+
+        float left_volts = (right_volts + LOG_DIFF_BIAS) * expf(position) - LOG_DIFF_BIAS;
+        float left_code = saturate(left_volts / LINE_SENSOR_GAIN * ADC_RESO / ADC_VREF, 0.0f, ADC_RESO);
+
+        codes.left.push_back((uint16_t) lroundf(left_code));
+        codes.right.push_back(2000);
+
+    }
+
+    return codes;
+
+}
+
+
+uint64_t runReference(const Codes& codes, std::vector<float>& angles, std::vector<uint16_t>& ticks) {
+
+    FIRFilter filter(ALPHA, 0.0f);
+    PIDController pid(KP, KI, KD, DT);
+
+    uint64_t start = monotonicTime();
+
+    for (size_t i = 0; i < codes.left.size(); i++) {
+
+        float response = pid.pass(0.0f, filter.pass(LINE_LOG_TABLE.logdiffRaw(codes.left[i], codes.right[i])));
+
+        angles[i] = response;
+        ticks[i] = PiCarX::steeringPulseWidth(response);
+
+    }
+
+    return monotonicTime() - start;
+
+}
+
+
+template <typename T>
+uint64_t runPipeline(const Codes& codes, std::vector<float>& angles, std::vector<uint16_t>& ticks) {
+
+    ControlPipeline<T> pipeline(LINE_LOG_TABLE, ALPHA, KP, KI, KD, DT, PiCarX::steeringMap());
+
+    uint64_t start = monotonicTime();
+
+    for (size_t i = 0; i < codes.left.size(); i++) {
+
+        T angle;
+
+        ticks[i] = pipeline.pass(codes.left[i], codes.right[i], &angle);
+        angles[i] = (float) angle;
+
+    }
+
+    return monotonicTime() - start;
+
+}
+
+
+bool report(const char* name, uint64_t ns, uint64_t reference_ns, const std::vector<float>& angles, const std::vector<uint16_t>& ticks,
+            const std::vector<float>& reference_angles, const std::vector<uint16_t>& reference_ticks) {
+
+    double max_angle_error = 0.0;
+    int max_tick_error = 0;
+    size_t tick_mismatches = 0;
+
+    for (size_t i = 0; i < angles.size(); i++) {
+
+        // Beyond the saturation both paths command the same pulse, the angle no longer matters
+        float limit = PiCarX::steeringMap().max_angle;
+
+        if (fabsf(reference_angles[i]) < limit) {
+            max_angle_error = fmax(max_angle_error, fabs((double) angles[i] - reference_angles[i]));
+        }
+
+        int tick_error = abs((int) ticks[i] - (int) reference_ticks[i]);
+
+        if (tick_error > 0) {
+            tick_mismatches++;
+        }
+
+        if (tick_error > max_tick_error) {
+            max_tick_error = tick_error;
+        }
+
+    }
+
+    bool valid = max_angle_error <= ANGLE_TOLERANCE && max_tick_error <= TICK_TOLERANCE;
+
+    printf("%s: %.2f ns/cycle (%.2fx), max angle error %.3g deg, max tick error %d (%zu of %zu cycles differ): %s\n",
+           name, (double) ns / angles.size(), (double) reference_ns / ns, max_angle_error, max_tick_error,
+           tick_mismatches, angles.size(), valid ? "ok" : "FAILED");
+
+    return valid;
+
+}
@@ -0,0 +1,176 @@
+#ifndef HARNESS_HPP
+
+    #define HARNESS_HPP
+
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <unistd.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+
+    #include "utilities.hpp"
+
+    #define BENCH_REPEATS 5     /** Timed runs of every benchmark, the fastest is reported. */
+
+    /**
+     * Shared by the benchmarks that report in CSV, one line per benchmark:
+     *
+     *     benchmark,iterations,ns_per_op,cycles_per_op
+     *
+     * cycles_per_op is left empty where the kernel does not expose the cycle counter (see
+     * /proc/sys/kernel/perf_event_paranoid). Both figures are the fastest of BENCH_REPEATS runs,
+     * which is the most stable value to compare between builds.
+     */
+
+    /**
+     * @brief Counts the CPU cycles spent in user space by the calling thread (perf_event_open).
+     */
+    class CycleCounter {
+
+        private:
+
+            int fd;     /** perf event file descriptor, negative if unavailable. */
+
+        public:
+
+            CycleCounter() {
+
+                struct perf_event_attr attr = {};
+
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+
+                this->fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+
+            }
+
+            // Prevent copy and assignment
+            CycleCounter(const CycleCounter&) = delete;
+            CycleCounter& operator=(const CycleCounter&) = delete;
+
+            /**
+             * @brief Checks if the cycle counter can be read.
+             * @return True if the counter is available, false otherwise.
+             */
+            bool isAvailable() const {
+
+                return this->fd >= 0;
+
+            }
+
+            /**
+             * @brief Reads the counter.
+             * @return The cycles counted since the counter was created, 0 if unavailable.
+             */
+            uint64_t read() const {
+
+                uint64_t value = 0;
+
+                if (this->fd < 0 || ::read(this->fd, &value, sizeof(value)) != sizeof(value)) {
+                    return 0;
+                }
+
+                return value;
+
+            }
+
+            ~CycleCounter() {
+
+                if (this->fd >= 0) {
+                    close(this->fd);
+                }
+
+            }
+
+    };
+
+    /**
+     * @brief The cost of one benchmark.
+     */
+    struct BenchResult {
+
+        const char* name;           /** Name of the benchmark.                      */
+        uint64_t iterations;        /** Operations per timed run.                   */
+        double ns_per_op;           /** Nanoseconds per operation.                  */
+        double cycles_per_op;       /** Cycles per operation, negative if unknown.  */
+
+    };
+
+    /**
+     * @brief Times an operation.
+     * @param name The name of the benchmark.
+     * @param iterations The number of operations per timed run.
+     * @param body The operation, called with the iteration index.
+     * @return The fastest of BENCH_REPEATS runs, after a warm-up run.
+     */
+    template <typename F>
+    BenchResult runBench(const char* name, uint64_t iterations, F body) {
+
+        static CycleCounter counter;
+
+        BenchResult result = { name, iterations, 0.0, -1.0 };
+
+        // Warm up the caches and the branch predictors
+        for (uint64_t i = 0; i < iterations; i++) {
+            body(i);
+        }
+
+        for (int run = 0; run < BENCH_REPEATS; run++) {
+
+            uint64_t cycles = counter.read();
+            uint64_t start = monotonicTime();
+
+            for (uint64_t i = 0; i < iterations; i++) {
+                body(i);
+            }
+
+            uint64_t elapsed = monotonicTime() - start;
+
+            cycles = counter.read() - cycles;
+
+            double ns = (double) elapsed / iterations;
+
+            if (run == 0 || ns < result.ns_per_op) {
+                result.ns_per_op = ns;
+            }
+
+            if (counter.isAvailable() && (result.cycles_per_op < 0.0 || (double) cycles / iterations < result.cycles_per_op)) {
+                result.cycles_per_op = (double) cycles / iterations;
+            }
+
+        }
+
+        return result;
+
+    }
+
+    /**
+     * @brief Prints the CSV header.
+     */
+    inline void printBenchHeader() {
+
+        printf("benchmark,iterations,ns_per_op,cycles_per_op\n");
+
+    }
+
+    /**
+     * @brief Prints a result as a CSV line.
+     * @param result The result.
+     */
+    inline void printBenchResult(const BenchResult& result) {
+
+        if (result.cycles_per_op >= 0.0) {
+            printf("%s,%llu,%.3f,%.1f\n", result.name, (unsigned long long) result.iterations, result.ns_per_op, result.cycles_per_op);
+        } else {
+            printf("%s,%llu,%.3f,\n", result.name, (unsigned long long) result.iterations, result.ns_per_op);
+        }
+
+        fflush(stdout);
+
+    }
+
+
+#endif // HARNESS_HPP
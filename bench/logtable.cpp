@@ -0,0 +1,82 @@
+#include "logtable.hpp"
+#include "picarx.hpp"
+#include "utilities.hpp"
+
+#include <stdio.h>
+#include <math.h>
+
+
+#define ERROR_BOUND 1e-6        // Documented bound of LogTable::logdiffRaw
+#define ITERATIONS 10000000
+
+
+// Built by the compiler
+constexpr LogTable LINE_LOG_TABLE(ADC_VREF / ADC_RESO * LINE_SENSOR_GAIN, LOG_DIFF_BIAS);
+
+
+/**
+ * @brief Computes the log difference of two codes the way the car did before the table.
+*/
+float reference(uint16_t a, uint16_t b) {
+
+    float left = PiCarX::toVoltage(ADC_IDX_A0, a) * LINE_SENSOR_GAIN;
+    float right = PiCarX::toVoltage(ADC_IDX_A3, b) * LINE_SENSOR_GAIN;
+
+    return logdiff(left, right, LOG_DIFF_BIAS);
+
+}
+
+
+
+int main() {
+
+    // Largest deviation from the reference over every pair of 12-bit codes
+    double worst = 0.0;
+    int worst_a = 0;
+    int worst_b = 0;
+
+    for (int a = 0; a < LOG_TABLE_SIZE; a++) {
+
+        for (int b = 0; b < LOG_TABLE_SIZE; b++) {
+
+            double error = fabs((double) LINE_LOG_TABLE.logdiffRaw(a, b) - (double) reference(a, b));
+
+            if (error > worst) {
+                worst = error;
+                worst_a = a;
+                worst_b = b;
+            }
+
+        }
+
+    }
+
+    printf("max |logdiffRaw - logdiff|: %.3g at (%d, %d), bound %.0e: %s\n", worst, worst_a, worst_b, ERROR_BOUND, (worst <= ERROR_BOUND) ? "ok" : "EXCEEDED");
+
+    // Cost per call, codes cycling through the whole domain
+    volatile float sink = 0.0f;
+
+    uint64_t start = monotonicTime();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink = reference(i & 4095, (i * 7) & 4095);
+    }
+
+    uint64_t reference_ns = monotonicTime() - start;
+
+    start = monotonicTime();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink = LINE_LOG_TABLE.logdiffRaw(i & 4095, (i * 7) & 4095);
+    }
+
+    uint64_t table_ns = monotonicTime() - start;
+
+    (void) sink;
+
+    printf("logdiff:    %.2f ns/op\n", (double) reference_ns / ITERATIONS);
+    printf("logdiffRaw: %.2f ns/op\n", (double) table_ns / ITERATIONS);
+
+    return (worst <= ERROR_BOUND) ? 0 : 1;
+
+}
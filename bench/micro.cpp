@@ -0,0 +1,122 @@
+#include "harness.hpp"
+#include "utilities.hpp"
+#include "filters.hpp"
+#include "pid.hpp"
+#include "logtable.hpp"
+#include "ringbuffer.hpp"
+#include "picarx.hpp"
+#include "i2c.hpp"
+#include "i2ctrace.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+
+#define INPUTS 1024             // Inputs cycled through, a power of two
+#define ITERATIONS 10000000
+
+
+constexpr LogTable LINE_LOG_TABLE(ADC_VREF / ADC_RESO * LINE_SENSOR_GAIN, LOG_DIFF_BIAS);
+
+// Results are written here so the compiler cannot drop the operations
+volatile float float_sink;
+volatile uint16_t word_sink;
+
+
+
+int main(int argc, char** argv) {
+
+    uint64_t iterations = (argc > 1) ? strtoull(argv[1], NULL, 10) : ITERATIONS;
+
+    // Random inputs in the ranges the car sees
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<int> codes(0, 4095);
+    std::uniform_real_distribution<float> volts(0.0f, 3.3f * LINE_SENSOR_GAIN);
+    std::uniform_real_distribution<float> errors(-2.0f, 2.0f);
+
+    uint16_t left[INPUTS], right[INPUTS];
+    float left_volts[INPUTS], right_volts[INPUTS], values[INPUTS];
+
+    for (int i = 0; i < INPUTS; i++) {
+
+        left[i] = codes(generator);
+        right[i] = codes(generator);
+        left_volts[i] = volts(generator);
+        right_volts[i] = volts(generator);
+        values[i] = errors(generator);
+
+    }
+
+    FIRFilter filter(0.5f, 0.0f);
+    PIDController pid(10.0f, 0.5f, 0.05f, 0.01f);
+    RobustPIDController robust(10.0f, 0.5f, 0.05f, -30.0f, 30.0f, 0.05f, 0.02f);
+    static RingBuffer<float, 128> ring;
+    float window[100];
+
+    printBenchHeader();
+
+    printBenchResult(runBench("logdiff", iterations, [&](uint64_t i) {
+        float_sink = logdiff(left_volts[i % INPUTS], right_volts[i % INPUTS], LOG_DIFF_BIAS);
+    }));
+
+    printBenchResult(runBench("logtable_logdiff_raw", iterations, [&](uint64_t i) {
+        float_sink = LINE_LOG_TABLE.logdiffRaw(left[i % INPUTS], right[i % INPUTS]);
+    }));
+
+    printBenchResult(runBench("saturate", iterations, [&](uint64_t i) {
+        float_sink = saturate(values[i % INPUTS] * 20.0f, -30.0f, 30.0f);
+    }));
+
+    printBenchResult(runBench("map", iterations, [&](uint64_t i) {
+        float_sink = map(values[i % INPUTS], -90.0f, 90.0f, 500.0f, 2500.0f);
+    }));
+
+    printBenchResult(runBench("fir_filter_pass", iterations, [&](uint64_t i) {
+        float_sink = filter.pass(values[i % INPUTS]);
+    }));
+
+    printBenchResult(runBench("pid_pass", iterations, [&](uint64_t i) {
+        float_sink = pid.pass(0.0f, values[i % INPUTS]);
+    }));
+
+    printBenchResult(runBench("robust_pid_pass", iterations, [&](uint64_t i) {
+        float_sink = robust.pass(0.0f, values[i % INPUTS], 0.01f);
+    }));
+
+    printBenchResult(runBench("ring_buffer_push", iterations, [&](uint64_t i) {
+        ring.push(values[i % INPUTS]);
+    }));
+
+    printBenchResult(runBench("ring_buffer_latest", iterations, [&](uint64_t) {
+        float value;
+        ring.latest(value);
+        float_sink = value;
+    }));
+
+    // A whole plot window per operation
+    printBenchResult(runBench("ring_buffer_snapshot_100", iterations / 100, [&](uint64_t) {
+        ring.snapshot(window, 100);
+        float_sink = window[0];
+    }));
+
+    printBenchResult(runBench("i2c_swap_bytes", iterations, [&](uint64_t i) {
+        word_sink = i2cSwapBytes(left[i % INPUTS]);
+    }));
+
+    printBenchResult(runBench("steering_pulse_width", iterations, [&](uint64_t i) {
+        word_sink = PiCarX::steeringPulseWidth(values[i % INPUTS] * 20.0f);
+    }));
+
+    // What tracing adds to a transaction reading one ADC channel of the MCU (0x14, a register write then a read)
+    uint8_t command[3] = { A0, 0, 0 };
+    uint8_t reply[2] = { 0, 0 };
+    struct i2c_msg msgs[2] = { { 0x14, 0, sizeof(command), command }, { 0x14, I2C_M_RD, sizeof(reply), reply } };
+
+    printBenchResult(runBench("i2c_trace_transfer", iterations, [&](uint64_t i) {
+        i2c_tracer.recordTransfer(msgs, 2, i, i + 1000, 2);
+    }));
+
+    return 0;
+
+}
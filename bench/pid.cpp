@@ -0,0 +1,69 @@
+#include "pid.hpp"
+
+#include <stdio.h>
+#include <math.h>
+
+
+#define KP 10.0f                // Steering limits and period of the car
+#define KD 0.05f
+#define OUT_LIMIT 30.0f
+#define DT 0.01f
+#define TAU 0.02f
+#define SATURATED_PASSES 200    // 2 s with the line far off-center
+#define SETTLE_PASSES 100       // 1 s for the derivative filter to settle
+#define TOLERANCE 1e-4f
+
+
+/**
+ * @brief Saturates a controller without integral gain, then brings the error back inside the
+ *        linear range and checks that the output is the proportional response again.
+ * @param name The name of the anti-windup strategy.
+ * @param anti_windup The anti-windup strategy.
+ * @param kb The back-calculation tracking gain (0 for the default).
+ * @return True if no integral was left behind, false otherwise.
+*/
+bool checkRecovery(const char* name, AntiWindup anti_windup, float kb);
+
+
+
+int main() {
+
+    bool valid = true;
+
+    valid &= checkRecovery("none", ANTI_WINDUP_NONE, 0.0f);
+    valid &= checkRecovery("clamp", ANTI_WINDUP_CLAMP, 0.0f);
+    valid &= checkRecovery("back_calculation", ANTI_WINDUP_BACK_CALCULATION, 0.0f);
+    valid &= checkRecovery("back_calculation_kb", ANTI_WINDUP_BACK_CALCULATION, 50.0f);
+
+    return valid ? 0 : 1;
+
+}
+
+
+bool checkRecovery(const char* name, AntiWindup anti_windup, float kb) {
+
+    RobustPIDController pid(KP, 0.0f, KD, -OUT_LIMIT, OUT_LIMIT, 2.0f * DT, TAU, anti_windup, kb);
+
+    // kp * 5 = 50 degrees, well past the 30 degree limit
+    for (int i = 0; i < SATURATED_PASSES; i++) {
+        pid.pass(0.0f, -5.0f, DT);
+    }
+
+    float output = 0.0f;
+
+    for (int i = 0; i < SETTLE_PASSES; i++) {
+        output = pid.pass(0.0f, -1.0f, DT);
+    }
+
+    float p, i, d;
+    pid.getTerms(p, i, d);
+
+    float expected = KP * 1.0f;
+    bool valid = fabsf(output - expected) <= TOLERANCE && i == 0.0f;
+
+    printf("ki = 0, %s: output %.6g after saturation (expected %.6g), integral %.6g: %s\n",
+           name, output, expected, i, valid ? "ok" : "FAILED");
+
+    return valid;
+
+}
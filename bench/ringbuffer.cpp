@@ -0,0 +1,288 @@
+#include "harness.hpp"
+#include "ringbuffer.hpp"
+#include "picarx.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+
+#define RING_SIZE 64            // Same as the sampler ring
+#define STRESS_ELEMENTS 2000000
+#define ITERATIONS 10000000
+
+
+/**
+ * @brief A stress element: every word is derived from the index, so a torn copy is detected.
+ */
+struct Element {
+
+    uint64_t index;
+    uint64_t words[6];
+    uint64_t check;
+
+};
+
+RingBuffer<Element, RING_SIZE> stress_ring;
+std::atomic<bool> writing;
+std::atomic<uint64_t> failures;
+
+
+Element makeElement(uint64_t index) {
+
+    Element element;
+
+    element.index = index;
+    element.check = ~index;
+
+    for (int i = 0; i < 6; i++) {
+        element.words[i] = index * (i + 3);
+    }
+
+    return element;
+
+}
+
+bool isIntact(const Element& element) {
+
+    bool intact = element.check == ~element.index;
+
+    for (int i = 0; i < 6; i++) {
+        intact &= element.words[i] == element.index * (i + 3);
+    }
+
+    return intact;
+
+}
+
+void fail(const char* reader, const char* problem, uint64_t index) {
+
+    if (failures.fetch_add(1) < 10) {
+        fprintf(stderr, "%s: %s at element %llu\n", reader, problem, (unsigned long long) index);
+    }
+
+}
+
+
+/**
+ * @brief Follows the writer with a cursor: every element comes in order, intact, or is counted as lost.
+ */
+void streamReader(uint64_t& received, uint64_t& lost) {
+
+    Element batch[16];
+    uint64_t cursor = 0;
+    uint64_t expected = 0;
+
+    received = 0;
+    lost = 0;
+
+    while (writing.load(std::memory_order_acquire) || cursor < stress_ring.count()) {
+
+        uint64_t before = cursor;
+        size_t copied = stress_ring.copy(cursor, batch, 16);
+
+        // The copied elements are the newest of those the cursor covered
+        expected = cursor - copied;
+        lost += (cursor - before) - copied;
+
+        for (size_t i = 0; i < copied; i++, expected++) {
+
+            if (!isIntact(batch[i])) {
+                fail("stream", "torn element", batch[i].index);
+            } else if (batch[i].index != expected) {
+                fail("stream", "out of order element", batch[i].index);
+            }
+
+        }
+
+        received += copied;
+
+    }
+
+}
+
+/**
+ * @brief Takes windows of the newest elements: each window is intact and contiguous.
+ */
+void windowReader(uint64_t& windows) {
+
+    Element window[RING_SIZE];
+
+    windows = 0;
+
+    while (writing.load(std::memory_order_acquire)) {
+
+        size_t copied = stress_ring.snapshot(window, RING_SIZE / 2);
+
+        for (size_t i = 0; i < copied; i++) {
+
+            if (!isIntact(window[i])) {
+                fail("window", "torn element", window[i].index);
+            } else if (i > 0 && window[i].index != window[i - 1].index + 1) {
+                fail("window", "gap in window", window[i].index);
+            }
+
+        }
+
+        windows++;
+
+    }
+
+}
+
+/**
+ * @brief Polls the newest element: it is intact and never goes back in time.
+ */
+void latestReader(uint64_t& polls) {
+
+    Element element;
+    uint64_t newest = 0;
+
+    polls = 0;
+
+    while (writing.load(std::memory_order_acquire)) {
+
+        if (stress_ring.latest(element)) {
+
+            if (!isIntact(element)) {
+                fail("latest", "torn element", element.index);
+            } else if (element.index < newest) {
+                fail("latest", "element older than a previous one", element.index);
+            } else {
+                newest = element.index;
+            }
+
+        }
+
+        polls++;
+
+    }
+
+}
+
+/**
+ * @brief Runs one writer against the three readers and checks what they saw.
+ */
+bool stress(uint64_t elements) {
+
+    uint64_t received, lost, windows, polls;
+
+    writing = true;
+    failures = 0;
+
+    std::thread stream(streamReader, std::ref(received), std::ref(lost));
+    std::thread window(windowReader, std::ref(windows));
+    std::thread latest(latestReader, std::ref(polls));
+
+    for (uint64_t i = 0; i < elements; i++) {
+
+        stress_ring.push(makeElement(i));
+
+        // Let the readers run in the middle of the writes, even on a single core
+        if ((i & 255) == 0) {
+            std::this_thread::yield();
+        }
+
+    }
+
+    writing.store(false, std::memory_order_release);
+
+    stream.join();
+    window.join();
+    latest.join();
+
+    if (received + lost != elements) {
+        fail("stream", "elements neither received nor lost", received + lost);
+    }
+
+    fprintf(stderr, "# stress: %llu elements, stream received %llu and lost %llu, %llu windows, %llu polls: %s\n",
+            (unsigned long long) elements, (unsigned long long) received, (unsigned long long) lost,
+            (unsigned long long) windows, (unsigned long long) polls, (failures == 0) ? "ok" : "FAILED");
+
+    return failures == 0;
+
+}
+
+
+
+int main(int argc, char** argv) {
+
+    uint64_t elements = (argc > 1) ? strtoull(argv[1], NULL, 10) : STRESS_ELEMENTS;
+    uint64_t iterations = (argc > 2) ? strtoull(argv[2], NULL, 10) : ITERATIONS;
+
+    if (!stress(elements)) {
+        return 1;
+    }
+
+    // Throughput with the element of the sampler
+    static RingBuffer<SensorFrame, RING_SIZE> frames;
+
+    SensorFrame frame = {};
+    SensorFrame window[RING_SIZE];
+    volatile uint64_t sink;
+
+    printBenchHeader();
+
+    printBenchResult(runBench("ring_buffer_push_frame", iterations, [&](uint64_t i) {
+        frame.timestamp = i;
+        frames.push(frame);
+    }));
+
+    printBenchResult(runBench("ring_buffer_latest_frame", iterations, [&](uint64_t) {
+        frames.latest(frame);
+        sink = frame.timestamp;
+    }));
+
+    printBenchResult(runBench("ring_buffer_snapshot_frame_64", iterations / RING_SIZE, [&](uint64_t) {
+        sink = frames.snapshot(window, RING_SIZE);
+    }));
+
+    // Writer and cursor reader on two threads, per element handed over (cycles span two threads, unknown)
+    BenchResult stream = { "ring_buffer_stream_frame", iterations, 0.0, -1.0 };
+
+    for (int run = 0; run < BENCH_REPEATS; run++) {
+
+        std::atomic<bool> done(false);
+        uint64_t received = 0;
+
+        uint64_t start = monotonicTime();
+
+        std::thread reader([&] {
+
+            SensorFrame batch[RING_SIZE];
+            uint64_t cursor = frames.count();
+
+            while (!done.load(std::memory_order_acquire) || cursor < frames.count()) {
+                received += frames.copy(cursor, batch, RING_SIZE);
+            }
+
+        });
+
+        for (uint64_t i = 0; i < iterations; i++) {
+
+            frame.timestamp = i;
+            frames.push(frame);
+
+        }
+
+        done.store(true, std::memory_order_release);
+        reader.join();
+
+        double ns = (double) (monotonicTime() - start) / iterations;
+
+        if (run == 0 || ns < stream.ns_per_op) {
+            stream.ns_per_op = ns;
+        }
+
+        sink = received;
+
+    }
+
+    printBenchResult(stream);
+
+    (void) sink;
+
+    return 0;
+
+}
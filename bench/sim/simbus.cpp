@@ -0,0 +1,178 @@
+#include "i2c.hpp"
+#include "simbus.hpp"
+#include "utilities.hpp"
+
+#define SIMBUS_FD 3     /** Descriptor handed out by i2cOpen, never a real file. */
+
+
+static uint16_t inputs[256];
+static uint16_t outputs[256];
+static uint8_t addressed = 0;           /** Register of the last write.                 */
+static int next_byte = 0;               /** Byte of the input word the next read returns. */
+static uint64_t byte_time_ns = 0;
+static SimBusStats stats = {};
+
+
+/**
+ * @brief Spends the wire time of some bytes and counts them.
+ */
+static void wire(uint64_t bytes) {
+
+    stats.bytes += bytes;
+
+    if (byte_time_ns == 0) {
+        return;
+    }
+
+    uint64_t end = monotonicTime() + bytes * byte_time_ns;
+
+    while (monotonicTime() < end);
+
+}
+
+
+/**
+ * @brief Handles a write of (register, high, low), or of a register alone.
+ */
+static void receive(const uint8_t* buffer, uint16_t len) {
+
+    if (len == 0) {
+        return;
+    }
+
+    addressed = buffer[0];
+    next_byte = 0;
+
+    if (len >= 3) {
+        outputs[addressed] = (uint16_t) ((buffer[1] << 8) | buffer[2]);
+    }
+
+}
+
+
+int i2cOpen(const char* path) {
+
+    (void) path;
+
+    return SIMBUS_FD;
+
+}
+
+
+int i2cSetAddress(int fd, uint16_t address) {
+
+    (void) address;
+
+    return (fd == SIMBUS_FD) ? 0 : -1;
+
+}
+
+
+int i2cTransfer(int fd, struct i2c_msg msgs[], uint32_t count) {
+
+    (void) fd;
+
+    stats.transactions++;
+    stats.messages += count;
+
+    uint64_t bytes = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        if (msgs[i].flags & I2C_M_RD) {
+
+            // The input word of the addressed register, high byte first
+            for (uint16_t k = 0; k < msgs[i].len; k++) {
+                msgs[i].buf[k] = (k % 2 == 0) ? inputs[addressed] >> 8 : inputs[addressed] & 0xff;
+            }
+
+        } else {
+
+            receive(msgs[i].buf, msgs[i].len);
+
+        }
+
+        bytes += msgs[i].len;
+
+    }
+
+    wire(bytes);
+
+    return (int) count;
+
+}
+
+
+int i2cWriteWord(int fd, uint8_t reg, uint16_t value) {
+
+    (void) fd;
+
+    stats.transactions++;
+
+    // SMBus sends the low byte first, the caller already swapped the word for the MCU
+    const uint8_t buffer[3] = { reg, (uint8_t) (value & 0xff), (uint8_t) (value >> 8) };
+
+    receive(buffer, sizeof(buffer));
+    wire(sizeof(buffer));
+
+    return 0;
+
+}
+
+
+int i2cReadByte(int fd) {
+
+    (void) fd;
+
+    stats.transactions++;
+
+    int byte = (next_byte == 0) ? inputs[addressed] >> 8 : inputs[addressed] & 0xff;
+
+    next_byte ^= 1;
+    wire(1);
+
+    return byte;
+
+}
+
+
+void i2cClose(int fd) {
+
+    (void) fd;
+
+}
+
+
+void simBusSetInput(uint8_t reg, uint16_t value) {
+
+    inputs[reg] = value;
+
+}
+
+
+uint16_t simBusGetOutput(uint8_t reg) {
+
+    return outputs[reg];
+
+}
+
+
+void simBusSetByteTime(uint64_t ns) {
+
+    byte_time_ns = ns;
+
+}
+
+
+SimBusStats simBusGetStats() {
+
+    return stats;
+
+}
+
+
+void simBusResetStats() {
+
+    stats = {};
+
+}
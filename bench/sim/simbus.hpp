@@ -0,0 +1,58 @@
+#ifndef SIMBUS_HPP
+
+    #define SIMBUS_HPP
+
+    #include <stdint.h>
+
+    /**
+     * A simulated I2C bus answering like the MCU of the PiCar-X, linked into the benchmarks in
+     * place of src/i2c.cpp (see include/i2c.hpp). A write of (register, high, low) stores the word
+     * in the outputs, a read returns the input word of the last register addressed, which is how
+     * the ADC channels are read. Not thread safe.
+     */
+
+    /**
+     * @brief Counters of the simulated bus traffic.
+     */
+    struct SimBusStats {
+
+        uint64_t transactions;  /** Combined transactions and SMBus calls.  */
+        uint64_t messages;      /** Messages of the combined transactions.  */
+        uint64_t bytes;         /** Bytes on the wire, addresses excluded.  */
+
+    };
+
+    /**
+     * @brief Sets the word a register answers with (e.g. an ADC code).
+     * @param reg The register.
+     * @param value The word.
+     */
+    void simBusSetInput(uint8_t reg, uint16_t value);
+
+    /**
+     * @brief Gets the last word written to a register.
+     * @param reg The register.
+     * @return The word, 0 if never written.
+     */
+    uint16_t simBusGetOutput(uint8_t reg);
+
+    /**
+     * @brief Sets the time every byte takes on the wire, spent busy-waiting (0, the default,
+     *        measures the software path alone; about 22500 models a 400 kHz bus).
+     * @param ns The time per byte in nanoseconds.
+     */
+    void simBusSetByteTime(uint64_t ns);
+
+    /**
+     * @brief Gets the traffic counters.
+     * @return The counters since the last reset.
+     */
+    SimBusStats simBusGetStats();
+
+    /**
+     * @brief Resets the traffic counters.
+     */
+    void simBusResetStats();
+
+
+#endif // SIMBUS_HPP
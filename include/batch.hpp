@@ -0,0 +1,124 @@
+#ifndef BATCH_HPP
+
+    #define BATCH_HPP
+
+    #include <stddef.h>
+    #include <vector>
+
+    /**
+     * @brief N first-order low-pass filters stepped together (structure of arrays).
+     *
+     * Every instance computes exactly what FIRFilter::pass computes, in the same order and with
+     * the same rounding, so a batch instance and a scalar filter fed the same inputs produce the
+     * same bits. The kernel uses AVX, SSE or NEON (aarch64) lanes when available.
+     */
+    class BatchFIRFilter {
+
+        private:
+
+            size_t count;               /** Number of instances.            */
+            std::vector<float> alpha;   /** Filter coefficients.            */
+            std::vector<float> beta;    /** 1 - alpha, as computed by pass. */
+            std::vector<float> xp;      /** Filter outputs.                 */
+
+        public:
+
+            /**
+             * @brief Construct a new BatchFIRFilter object.
+             * @param count The number of instances (all pass-through, alpha = 1, x0 = 0).
+             */
+            BatchFIRFilter(size_t count);
+
+            /**
+             * @brief Configures an instance.
+             * @param index The index of the instance.
+             * @param alpha The filter coefficient.
+             * @param x0 The initial output value.
+             */
+            void set(size_t index, float alpha, float x0=0.0f);
+
+            /**
+             * @brief Updates every instance with its new input value.
+             * @param x The input values, one per instance.
+             * @param out Receives the filter outputs, one per instance (may be x).
+             */
+            void pass(const float x[], float out[]);
+
+            /**
+             * @brief Resets the state of every instance.
+             */
+            void reset(float x0=0.0f);
+
+            /**
+             * @brief Gets the number of instances.
+             * @return The number of instances.
+             */
+            size_t size() const;
+
+    };
+
+    /**
+     * @brief N PID controllers stepped together (structure of arrays).
+     *
+     * Every instance computes exactly what PIDController::pass computes, in the same order and
+     * with the same rounding (the division by dt is a true division, not a reciprocal estimate).
+     */
+    class BatchPIDController {
+
+        private:
+
+            size_t count;               /** Number of instances.    */
+            std::vector<float> kp;      /** Proportional gains.     */
+            std::vector<float> ki;      /** Integral gains.         */
+            std::vector<float> kd;      /** Derivative gains.       */
+            std::vector<float> dt;      /** Time steps.             */
+            std::vector<float> ierr;    /** Integral errors.        */
+            std::vector<float> derr;    /** Derivative errors.      */
+
+        public:
+
+            /**
+             * @brief Construct a new BatchPIDController object.
+             * @param count The number of instances (all gains 0, dt = 1).
+             */
+            BatchPIDController(size_t count);
+
+            /**
+             * @brief Configures an instance.
+             * @param index The index of the instance.
+             * @param kp The proportional gain.
+             * @param ki The integral gain.
+             * @param kd The derivative gain.
+             * @param dt The time step.
+             */
+            void set(size_t index, float kp, float ki, float kd, float dt);
+
+            /**
+             * @brief Updates every instance using its setpoint and current input value.
+             * @param setpoints The desired values, one per instance.
+             * @param values The current values, one per instance.
+             * @param responses Receives the outputs, one per instance (may alias an input).
+             */
+            void pass(const float setpoints[], const float values[], float responses[]);
+
+            /**
+             * @brief Resets the state of every instance.
+             */
+            void reset();
+
+            /**
+             * @brief Gets the number of instances.
+             * @return The number of instances.
+             */
+            size_t size() const;
+
+    };
+
+    /**
+     * @brief Gets the instruction set used by the batch kernels.
+     * @return "avx", "sse", "neon" or "scalar".
+     */
+    const char* batchInstructionSet();
+
+
+#endif // BATCH_HPP
@@ -0,0 +1,202 @@
+#ifndef CALIBRATION_HPP
+
+    #define CALIBRATION_HPP
+
+    #include <stdint.h>
+
+    #include "picarx.hpp"
+
+    #define CALIBRATION_VERSION 1
+
+    /**
+     * @brief The running mean and variance of a stream of samples (Welford's algorithm).
+     *
+     * With a window, the count stops growing once it reaches the window and every new sample
+     * weighs 1 / window, so the statistics follow a slow drift instead of freezing.
+     */
+    class RunningStats {
+
+        private:
+
+            uint64_t n;         /** Number of samples, at most the window.          */
+            uint64_t window;    /** Largest count, 0 for an unbounded count.        */
+            double m;           /** Running mean.                                   */
+            double m2;          /** Sum of the squared deviations from the mean.    */
+
+        public:
+
+            /**
+             * @brief Construct a new RunningStats object.
+             * @param window The largest count, 0 for an unbounded count.
+             */
+            RunningStats(uint64_t window=0);
+
+            /**
+             * @brief Adds a sample.
+             * @param x The sample.
+             */
+            void add(double x);
+
+            /**
+             * @brief Sets the statistics, e.g. from a saved calibration.
+             * @param count The number of samples.
+             * @param mean The mean.
+             * @param variance The sample variance.
+             */
+            void set(uint64_t count, double mean, double variance);
+
+            /**
+             * @brief Gets the number of samples (capped to the window).
+             * @return The number of samples.
+             */
+            uint64_t count() const;
+
+            /**
+             * @brief Gets the mean of the samples.
+             * @return The mean, 0 without samples.
+             */
+            double mean() const;
+
+            /**
+             * @brief Gets the sample variance.
+             * @return The variance, 0 with less than 2 samples.
+             */
+            double variance() const;
+
+            /**
+             * @brief Gets the standard error of the mean, sqrt(variance / count).
+             * @return The standard error, infinity with less than 2 samples.
+             */
+            double standardError() const;
+
+            /**
+             * @brief Clears the samples.
+             */
+            void reset();
+
+    };
+
+    /**
+     * @brief A calibration as saved to disk: the offsets of the line sensors and when they were measured.
+     */
+    struct CalibrationData {
+
+        int64_t timestamp;                  /** Wall clock time of the measurement in seconds.          */
+        float battery;                      /** Battery voltage at the time of the measurement.         */
+        uint8_t mask;                       /** Channels calibrated (ADC_MASK_*).                       */
+        uint64_t samples;                   /** Number of samples the statistics are computed from.    */
+        double logdiff_mean;                /** Mean log difference, the initial value of the filter.   */
+        double logdiff_variance;            /** Variance of the log difference.                         */
+        double mean[ADC_CHANNELS];          /** Mean raw code of every calibrated channel.              */
+        double variance[ADC_CHANNELS];      /** Variance of the raw code of every calibrated channel.   */
+
+    };
+
+    /**
+     * @brief The offsets of the line sensors, measured at startup and refined while driving.
+     *
+     * Startup sampling stops as soon as the mean log difference is known within a tolerance
+     * (its standard error). The result can be saved to a small text file and reused on the next
+     * start if it is recent, was measured at a similar battery voltage and agrees with a few fresh
+     * samples. Not thread safe: one thread adds the samples and publishes snapshots of the data.
+     */
+    class Calibration {
+
+        private:
+
+            uint8_t mask;                           /** Channels calibrated (ADC_MASK_*).           */
+            RunningStats logdiff;                   /** Statistics of the log difference.           */
+            RunningStats channels[ADC_CHANNELS];    /** Statistics of the raw codes.                */
+
+        public:
+
+            /**
+             * @brief Construct a new Calibration object.
+             * @param mask The channels to calibrate (ADC_MASK_*).
+             * @param window The window of the statistics (see RunningStats), 0 for an unbounded count.
+             */
+            Calibration(uint8_t mask, uint64_t window=0);
+
+            /**
+             * @brief Adds a sample.
+             * @param raw The raw codes indexed by ADC_IDX_*, only the calibrated channels are used.
+             * @param logdiff The log difference of the sample.
+             */
+            void add(const uint16_t raw[ADC_CHANNELS], double logdiff);
+
+            /**
+             * @brief Checks if the mean log difference is known within a tolerance.
+             * @param tolerance The largest standard error of the mean log difference.
+             * @param min_samples The fewest samples the variance is trusted with.
+             * @return True if the calibration converged, false otherwise.
+             */
+            bool converged(double tolerance, uint64_t min_samples) const;
+
+            /**
+             * @brief Checks if fresh samples agree with the calibration.
+             * @param fresh The statistics of the fresh log differences.
+             * @param sigmas The largest deviation of their mean, in standard deviations of the
+             *               calibration plus the standard error of the fresh mean.
+             * @return True if the samples agree, false otherwise.
+             */
+            bool agrees(const RunningStats& fresh, double sigmas) const;
+
+            /**
+             * @brief Gets the number of samples.
+             * @return The number of samples.
+             */
+            uint64_t count() const;
+
+            /**
+             * @brief Gets the mean log difference, the initial value of the filter.
+             * @return The mean log difference.
+             */
+            double offset() const;
+
+            /**
+             * @brief Gets the calibration data.
+             * @param timestamp The wall clock time in seconds to stamp the data with.
+             * @param battery The battery voltage to stamp the data with.
+             * @return The data.
+             */
+            CalibrationData data(int64_t timestamp, float battery) const;
+
+            /**
+             * @brief Replaces the statistics with saved data.
+             * @param data The data, its mask must be the mask of the calibration.
+             * @return True if the data was restored, false if the masks differ.
+             */
+            bool restore(const CalibrationData& data);
+
+            /**
+             * @brief Writes calibration data to a file (through a temporary file, so a crash never
+             *        leaves a truncated calibration).
+             * @param path The path of the file.
+             * @param data The data.
+             * @return True if the file was written, false otherwise.
+             */
+            static bool save(const char* path, const CalibrationData& data);
+
+            /**
+             * @brief Reads calibration data from a file.
+             * @param path The path of the file.
+             * @param data Receives the data.
+             * @return True if the file exists and is a valid calibration, false otherwise.
+             */
+            static bool load(const char* path, CalibrationData& data);
+
+            /**
+             * @brief Checks if saved data can still be used.
+             * @param data The data.
+             * @param now The wall clock time in seconds.
+             * @param battery The battery voltage.
+             * @param max_age The largest age of the data in seconds.
+             * @param max_battery_delta The largest difference of battery voltage in volts.
+             * @return True if the data is recent and was measured at a similar battery voltage.
+             */
+            static bool isFresh(const CalibrationData& data, int64_t now, float battery, int64_t max_age, float max_battery_delta);
+
+    };
+
+
+#endif // CALIBRATION_HPP
@@ -0,0 +1,192 @@
+#ifndef CONFIG_HPP
+
+    #define CONFIG_HPP
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <atomic>
+    #include <mutex>
+    #include <vector>
+
+    #include "logtable.hpp"
+
+    #define CONFIG_MAX_DT_US 50000  /** Longest control period, the PID shortens longer time steps to it. */
+
+    /**
+     * @brief The tunable parameters of the control loop.
+     *
+     * They are read from defaults, then from a configuration file of "key = value" lines ('#'
+     * starts a comment), then from "--key value" or "--key=value" command line arguments, so the
+     * command line wins. The keys are the member names.
+     */
+    struct ControlParameters {
+
+        float kp;               /** Proportional gain.                                  */
+        float ki;               /** Integral gain.                                      */
+        float kd;               /** Derivative gain.                                    */
+        float speed;            /** Motor speed in [-1, 1].                             */
+        float filter_alpha;     /** Coefficient of the single-pole filter in (0, 1].   */
+        float log_diff_bias;    /** Bias added to the sensor voltages before the log.   */
+        int dt_us;              /** Control period in microseconds (CONFIG_MAX_DT_US max). */
+
+    };
+
+    /**
+     * @brief Sets a parameter from its text value.
+     * @param parameters The parameters.
+     * @param key The name of the parameter.
+     * @param value The value.
+     * @return False if the key is unknown or the value is not a number.
+     */
+    bool setConfigValue(ControlParameters& parameters, const char* key, const char* value);
+
+    /**
+     * @brief Checks that the parameters are usable, printing the first problem.
+     * @param parameters The parameters.
+     * @return True if the parameters are valid, false otherwise.
+     */
+    bool validateConfig(const ControlParameters& parameters);
+
+    /**
+     * @brief Reads the parameters: defaults, then the file given by --config (if any), then the
+     *        other command line arguments.
+     * @param argc The number of arguments.
+     * @param argv The arguments, argv[0] being the program name.
+     * @param defaults The default parameters.
+     * @param parameters Receives the parameters.
+     * @param path If not NULL, receives the path of the configuration file (NULL without --config).
+     * @return True if every source was read and the result is valid, false otherwise.
+     */
+    bool loadConfig(int argc, char** argv, const ControlParameters& defaults, ControlParameters& parameters, const char** path=NULL);
+
+    /**
+     * @brief An immutable block of parameters, with everything the control step derives from them.
+     */
+    struct ControlConfig {
+
+        uint64_t epoch;                 /** Publication number, set by ConfigPublisher.         */
+        ControlParameters parameters;   /** The parameters.                                     */
+        LogTable logs;                  /** Log table of the line sensors for the bias.         */
+
+        /**
+         * @brief Construct a new ControlConfig object (builds the log table, not for the hot path).
+         * @param parameters The parameters.
+         * @param scale The value of one ADC code of the line sensors.
+         */
+        ControlConfig(const ControlParameters& parameters, double scale);
+
+    };
+
+    /**
+     * @brief Publishes configuration blocks to a single reader thread without locking it.
+     *
+     * The reader calls acquire() once per cycle and uses the returned block until its next call.
+     * acquire() is an atomic load and an atomic store: it also acknowledges the epoch of the
+     * block, which tells the publisher the reader no longer uses any older block. publish() swaps
+     * the pointer and retires the previous block, reclaim() frees the retired blocks older than
+     * the acknowledged epoch. Publishers serialize on a mutex the reader never takes.
+     */
+    class ConfigPublisher {
+
+        private:
+
+            std::atomic<const ControlConfig*> current;      /** The published block.                    */
+            std::atomic<uint64_t> acknowledged;             /** Epoch of the block the reader last took.*/
+            std::mutex publishing;                          /** Serializes publish() and reclaim().     */
+            std::vector<const ControlConfig*> retired;      /** Replaced blocks not yet freed.          */
+            uint64_t epoch;                                 /** Epoch of the published block.           */
+
+        public:
+
+            /**
+             * @brief Construct a new ConfigPublisher object.
+             * @param initial The first block, owned by the publisher from now on.
+             */
+            ConfigPublisher(ControlConfig* initial);
+
+            // Prevent copy and assignment
+            ConfigPublisher(const ConfigPublisher&) = delete;
+            ConfigPublisher& operator=(const ConfigPublisher&) = delete;
+
+            /**
+             * @brief Gets the published block (reader side, wait-free).
+             * @return The block, valid until the next call.
+             */
+            const ControlConfig* acquire() {
+
+                const ControlConfig* config = this->current.load(std::memory_order_acquire);
+
+                // Every block older than this one is no longer used once the store is visible
+                this->acknowledged.store(config->epoch, std::memory_order_release);
+
+                return config;
+
+            }
+
+            /**
+             * @brief Publishes a new block (publisher side).
+             * @param config The block, owned by the publisher from now on.
+             */
+            void publish(ControlConfig* config);
+
+            /**
+             * @brief Frees the retired blocks the reader acknowledged past (publisher side).
+             * @return The number of blocks still waiting to be freed.
+             */
+            size_t reclaim();
+
+            ~ConfigPublisher();
+
+    };
+
+    /**
+     * @brief Watches a file for changes with inotify, without blocking.
+     *
+     * The directory is watched rather than the file, so a file replaced by a rename (as most
+     * editors save) is still seen.
+     */
+    class ConfigWatcher {
+
+        private:
+
+            int fd;                 /** inotify file descriptor.                */
+            char name[256];         /** Name of the file within the directory.  */
+
+        public:
+
+            ConfigWatcher();
+
+            // Prevent copy and assignment
+            ConfigWatcher(const ConfigWatcher&) = delete;
+            ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+            /**
+             * @brief Starts watching a file.
+             * @param path The path of the file.
+             * @return True if the watch was set, false otherwise.
+             */
+            bool open(const char* path);
+
+            /**
+             * @brief Drains the pending events.
+             * @return True if the file was written or replaced since the last call.
+             */
+            bool changed();
+
+            /**
+             * @brief Checks if a file is watched.
+             * @return True if a file is watched, false otherwise.
+             */
+            bool isOpen() const;
+
+            /**
+             * @brief Stops watching.
+             */
+            void close();
+
+            ~ConfigWatcher();
+
+    };
+
+
+#endif // CONFIG_HPP
@@ -0,0 +1,113 @@
+#ifndef CONSTMATH_HPP
+
+    #define CONSTMATH_HPP
+
+    #include <limits>
+
+    /**
+     * Math functions usable in constant expressions (tables and coefficients computed by the
+     * compiler). They are accurate to a few double ulps on their documented domain and are
+     * not meant for the hot path, where the tables they build are used instead.
+     */
+
+    #define CONST_PI 3.14159265358979323846264338327950288
+    #define CONST_LN2 0.693147180559945309417232121458176568
+    #define CONST_SQRT2 1.41421356237309504880168872420969808
+
+    /**
+     * @brief Computes the natural logarithm.
+     * @param x The value.
+     * @return log(x), -infinity for 0 and NaN for negative values or NaN.
+     */
+    constexpr double constLog(double x) {
+
+        if (x != x || x < 0.0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        if (x == 0.0) {
+            return -std::numeric_limits<double>::infinity();
+        }
+
+        if (x == std::numeric_limits<double>::infinity()) {
+            return x;
+        }
+
+        // Reduce to m * 2^e with m in [sqrt(2)/2, sqrt(2)), scaling by 2 is exact
+        int e = 0;
+
+        while (x >= CONST_SQRT2) {
+            x *= 0.5;
+            e++;
+        }
+
+        while (x < CONST_SQRT2 * 0.5) {
+            x *= 2.0;
+            e--;
+        }
+
+        // log(m) = 2 atanh(z) = 2 (z + z^3/3 + z^5/5 + ...) with |z| <= 0.172
+        double z = (x - 1.0) / (x + 1.0);
+        double z2 = z * z;
+        double term = z;
+        double sum = 0.0;
+
+        for (int k = 1; k < 40; k += 2) {
+            sum += term / k;
+            term *= z2;
+        }
+
+        return 2.0 * sum + e * CONST_LN2;
+
+    }
+
+    /**
+     * @brief Computes the sine.
+     * @param x The angle in radians (accurate for |x| up to a few thousand radians).
+     * @return sin(x).
+     */
+    constexpr double constSin(double x) {
+
+        // Reduce to [-pi, pi]
+        double turns = x / (2.0 * CONST_PI);
+        long long whole = (long long) (turns + ((turns < 0.0) ? -0.5 : 0.5));
+
+        x -= whole * (2.0 * CONST_PI);
+
+        // Taylor series, x - x^3/3! + x^5/5! - ...
+        double term = x;
+        double sum = 0.0;
+
+        for (int k = 1; k < 60; k += 2) {
+            sum += term;
+            term *= -x * x / ((k + 1) * (k + 2));
+        }
+
+        return sum;
+
+    }
+
+    /**
+     * @brief Computes the cosine.
+     * @param x The angle in radians (accurate for |x| up to a few thousand radians).
+     * @return cos(x).
+     */
+    constexpr double constCos(double x) {
+
+        return constSin(x + CONST_PI / 2.0);
+
+    }
+
+    /**
+     * @brief Computes the tangent.
+     * @param x The angle in radians, away from the poles.
+     * @return tan(x).
+     */
+    constexpr double constTan(double x) {
+
+        return constSin(x) / constCos(x);
+
+    }
+
+
+#endif // CONSTMATH_HPP
@@ -0,0 +1,135 @@
+#ifndef EXECUTOR_HPP
+
+    #define EXECUTOR_HPP
+
+    #include <stdint.h>
+    #include <pthread.h>
+    #include <atomic>
+    #include <thread>
+
+    #include "picarx.hpp"
+    #include "spsc.hpp"
+    #include "histogram.hpp"
+
+    #define IO_QUEUE_SIZE 16
+
+    /**
+     * @brief Runs all PiCar-X bus traffic on a dedicated thread.
+     *
+     * The control thread submits actuator frames and collects sensor frames through lock-free
+     * single-producer/single-consumer queues with latest-value-wins semantics, so the filter and
+     * PID math overlaps with the I2C transfers instead of waiting on them. The I/O thread sleeps on
+     * an eventfd signalled by submit(), until the next sample when it samples, so a command is
+     * applied as soon as it is queued without polling. While the executor is running it is the
+     * only thread actuating through the PiCarX object.
+     */
+    class IOExecutor {
+
+        private:
+
+            PiCarX* picarx;                                         /** The connected PiCar-X.                  */
+            uint8_t mask;                                           /** Channels sampled every period.          */
+            int period_us;                                          /** Sampling period in microseconds.        */
+            SPSCQueue<ActuatorFrame, IO_QUEUE_SIZE> commands;       /** Control thread to I/O thread.           */
+            SPSCQueue<SensorFrame, IO_QUEUE_SIZE> samples;          /** I/O thread to control thread.           */
+            std::atomic<bool> running;                              /** Whether the I/O thread is running.      */
+            int wakeup;                                             /** eventfd signalled on new commands.      */
+            std::atomic<uint64_t> dropped_commands;                 /** Commands dropped on a full queue.       */
+            std::atomic<uint64_t> dropped_samples;                  /** Sensor frames dropped on a full queue.  */
+            std::atomic<uint64_t> failed_reads;                     /** Sensor transactions that failed.        */
+            LatencyHistogram read_latency;                          /** Duration of the sensor transactions.    */
+            LatencyHistogram write_latency;                         /** Duration of the actuator transactions.  */
+            std::thread io_thread;                                  /** The I/O thread.                         */
+
+            /**
+             * @brief The I/O thread body.
+             */
+            void run();
+
+            /**
+             * @brief Sleeps until a command is queued or the deadline passes (I/O thread).
+             * @param deadline The monotonic time in nanoseconds to wake up at (0 waits for a command).
+             */
+            void wait(uint64_t deadline);
+
+            /**
+             * @brief Wakes the I/O thread up.
+             */
+            void notify();
+
+        public:
+
+            /**
+             * @brief Construct a new IOExecutor object (does nothing, use start() to start the I/O thread).
+             * @param picarx The connected PiCar-X.
+             * @param mask The channels to sample (bitwise or of ADC_MASK_*, 0 to only apply actuator frames).
+             * @param period_us The sampling period in microseconds.
+             */
+            IOExecutor(PiCarX* picarx, uint8_t mask, int period_us);
+
+            // Prevent copy and assignment
+            IOExecutor(const IOExecutor&) = delete;
+            IOExecutor& operator=(const IOExecutor&) = delete;
+
+            /**
+             * @brief Starts the I/O thread.
+             * @return False if the thread could not be created.
+             */
+            bool start();
+
+            /**
+             * @brief Stops the I/O thread, after which the PiCarX object can be used directly again.
+             */
+            void stop();
+
+            /**
+             * @brief Queues an actuator frame (control thread only). Only the newest queued frame is applied.
+             * @param frame The actuator frame.
+             * @return False if the queue was full and the frame was dropped.
+             */
+            bool submit(const ActuatorFrame& frame);
+
+            /**
+             * @brief Gets the newest sensor frame published since the last call (control thread only).
+             * @param frame Receives the sensor frame.
+             * @return False if no new frame was published.
+             */
+            bool latest(SensorFrame& frame);
+
+            /**
+             * @brief Gets the number of frames dropped because a queue was full.
+             * @param commands Receives the number of dropped actuator frames.
+             * @param samples Receives the number of dropped sensor frames.
+             */
+            void getDrops(uint64_t& commands, uint64_t& samples);
+
+            /**
+             * @brief Gets the number of sensor transactions that failed.
+             * @return The number of failed reads.
+             */
+            uint64_t getFailedReads();
+
+            /**
+             * @brief Gets the latency histogram of the sensor transactions.
+             * @return The histogram, in nanoseconds.
+             */
+            const LatencyHistogram& getReadLatency();
+
+            /**
+             * @brief Gets the latency histogram of the actuator transactions.
+             * @return The histogram, in nanoseconds.
+             */
+            const LatencyHistogram& getWriteLatency();
+
+            /**
+             * @brief Gets the native handle of the I/O thread (e.g. to set its priority or affinity).
+             * @return The pthread handle of the I/O thread.
+             */
+            pthread_t nativeHandle();
+
+            ~IOExecutor();
+
+    };
+
+
+#endif // EXECUTOR_HPP
@@ -0,0 +1,343 @@
+#ifndef FILTERBANK_HPP
+
+    #define FILTERBANK_HPP
+
+    #include <stddef.h>
+
+    #include "constmath.hpp"
+
+    /**
+     * Header-only filters templated on the sample type T (float, double, or any type with the
+     * arithmetic operators and a conversion from double) and on their order. They all provide
+     * pass(x), which returns the new output, and reset(x0), which puts the filter in the steady
+     * state of a constant input x0, like FIRFilter, so any of them can filter the log difference.
+     */
+
+    /**
+     * @brief An N-tap finite impulse response filter.
+     *
+     * The history is written twice in a buffer of 2N samples, so the last N samples are always
+     * contiguous and the convolution is a straight dot product with no wrap-around. The dot
+     * product keeps four independent accumulators, which the compiler maps to vector lanes
+     * without reordering any sum (the result does not depend on the optimization level).
+     */
+    template <typename T, size_t N>
+    class FIR {
+
+        static_assert(N > 0, "a FIR filter needs at least one tap");
+
+        private:
+
+            T taps[N];          /** Coefficients, taps[0] weighs the newest sample.         */
+            T history[2 * N];   /** Last N samples, twice, newest at history[head].         */
+            size_t head;        /** Index of the newest sample in [0, N).                   */
+
+        public:
+
+            /**
+             * @brief Construct a new FIR object.
+             * @param taps The coefficients, taps[0] weighs the newest sample.
+             * @param x0 The initial value of the history.
+             */
+            constexpr FIR(const T (&taps)[N], T x0=T()) : taps(), history(), head(0) {
+
+                for (size_t i = 0; i < N; i++) {
+                    this->taps[i] = taps[i];
+                }
+
+                this->reset(x0);
+
+            }
+
+            /**
+             * @brief Designs a linear-phase low-pass filter (windowed sinc, Hamming window, unit DC gain).
+             * @param cutoff_hz The cutoff frequency in Hz.
+             * @param dt The sampling period in seconds.
+             * @return The filter.
+             */
+            static constexpr FIR lowpass(double cutoff_hz, double dt) {
+
+                T taps[N] = {};
+                double weights[N] = {};
+                double sum = 0.0;
+
+                double fc = cutoff_hz * dt;
+                double center = (N - 1) / 2.0;
+
+                for (size_t i = 0; i < N; i++) {
+
+                    double t = i - center;
+                    double sinc = (t == 0.0) ? 2.0 * fc : constSin(2.0 * CONST_PI * fc * t) / (CONST_PI * t);
+                    double window = (N == 1) ? 1.0 : 0.54 - 0.46 * constCos(2.0 * CONST_PI * i / (N - 1));
+
+                    weights[i] = sinc * window;
+                    sum += weights[i];
+
+                }
+
+                for (size_t i = 0; i < N; i++) {
+                    taps[i] = T(weights[i] / sum);
+                }
+
+                return FIR(taps);
+
+            }
+
+            /**
+             * @brief Updates the filter using the new input value.
+             * @param x The new input value.
+             * @return The filter output.
+             */
+            T pass(T x) {
+
+                this->head = (this->head == 0) ? N - 1 : this->head - 1;
+                this->history[this->head] = x;
+                this->history[this->head + N] = x;
+
+                const T* samples = this->history + this->head;
+
+                T acc[4] = { T(), T(), T(), T() };
+
+                size_t i = 0;
+
+                for (; i + 4 <= N; i += 4) {
+                    acc[0] = acc[0] + this->taps[i] * samples[i];
+                    acc[1] = acc[1] + this->taps[i + 1] * samples[i + 1];
+                    acc[2] = acc[2] + this->taps[i + 2] * samples[i + 2];
+                    acc[3] = acc[3] + this->taps[i + 3] * samples[i + 3];
+                }
+
+                for (; i < N; i++) {
+                    acc[i % 4] = acc[i % 4] + this->taps[i] * samples[i];
+                }
+
+                return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+
+            }
+
+            /**
+             * @brief Resets the filter state.
+             * @param x0 The value the whole history is set to.
+             */
+            constexpr void reset(T x0=T()) {
+
+                for (size_t i = 0; i < 2 * N; i++) {
+                    this->history[i] = x0;
+                }
+
+                this->head = 0;
+
+            }
+
+    };
+
+    /**
+     * @brief The coefficients of a biquad section, normalized so that a0 = 1.
+     */
+    template <typename T>
+    struct BiquadSection {
+
+        T b0;   /** Feed-forward coefficients.  */
+        T b1;
+        T b2;
+        T a1;   /** Feedback coefficients.      */
+        T a2;
+
+    };
+
+    /**
+     * @brief A cascade of S second-order sections (order 2S), in direct form II transposed.
+     *
+     * The transposed form keeps two state variables per section and has good numerical behavior
+     * in floating point. Coefficients are designed at compile time with butterworth().
+     */
+    template <typename T, size_t S>
+    class BiquadCascade {
+
+        static_assert(S > 0, "a biquad cascade needs at least one section");
+
+        private:
+
+            BiquadSection<T> sections[S];   /** Coefficients of the sections, applied in order. */
+            T s1[S];                        /** First state variable of every section.          */
+            T s2[S];                        /** Second state variable of every section.         */
+
+        public:
+
+            /**
+             * @brief Construct a new BiquadCascade object.
+             * @param sections The coefficients of the sections, applied in order.
+             * @param x0 The constant input the state starts in.
+             */
+            constexpr BiquadCascade(const BiquadSection<T> (&sections)[S], T x0=T()) : sections(), s1(), s2() {
+
+                for (size_t k = 0; k < S; k++) {
+                    this->sections[k] = sections[k];
+                }
+
+                this->reset(x0);
+
+            }
+
+            /**
+             * @brief Designs a Butterworth low-pass filter of order 2S (bilinear transform, prewarped cutoff).
+             * @param cutoff_hz The cutoff frequency in Hz, below the Nyquist frequency 1 / (2 dt).
+             * @param dt The sampling period in seconds.
+             * @return The filter.
+             */
+            static constexpr BiquadCascade butterworth(double cutoff_hz, double dt) {
+
+                BiquadSection<T> sections[S] = {};
+
+                double k = constTan(CONST_PI * cutoff_hz * dt);
+
+                for (size_t i = 0; i < S; i++) {
+
+                    // Quality factor of the i-th conjugate pole pair of the analog prototype
+                    double q = 1.0 / (2.0 * constSin(CONST_PI * (2 * i + 1) / (4.0 * S)));
+                    double norm = 1.0 / (1.0 + k / q + k * k);
+
+                    sections[i].b0 = T(k * k * norm);
+                    sections[i].b1 = T(2.0 * k * k * norm);
+                    sections[i].b2 = T(k * k * norm);
+                    sections[i].a1 = T(2.0 * (k * k - 1.0) * norm);
+                    sections[i].a2 = T((1.0 - k / q + k * k) * norm);
+
+                }
+
+                return BiquadCascade(sections);
+
+            }
+
+            /**
+             * @brief Updates the filter using the new input value.
+             * @param x The new input value.
+             * @return The filter output.
+             */
+            T pass(T x) {
+
+                for (size_t k = 0; k < S; k++) {
+
+                    const BiquadSection<T>& c = this->sections[k];
+
+                    T y = c.b0 * x + this->s1[k];
+
+                    this->s1[k] = c.b1 * x - c.a1 * y + this->s2[k];
+                    this->s2[k] = c.b2 * x - c.a2 * y;
+
+                    x = y;
+
+                }
+
+                return x;
+
+            }
+
+            /**
+             * @brief Resets the filter state.
+             * @param x0 The constant input the state is set to the steady state of.
+             */
+            constexpr void reset(T x0=T()) {
+
+                for (size_t k = 0; k < S; k++) {
+
+                    const BiquadSection<T>& c = this->sections[k];
+
+                    // Steady state of a constant input: y = gain * x, then solve the state equations
+                    T y = (c.b0 + c.b1 + c.b2) * x0 / (T(1.0) + c.a1 + c.a2);
+
+                    this->s1[k] = y - c.b0 * x0;
+                    this->s2[k] = c.b2 * x0 - c.a2 * y;
+
+                    x0 = y;
+
+                }
+
+            }
+
+    };
+
+    /**
+     * @brief A sliding median over the last N samples, rejecting isolated spikes (ADC glitches).
+     *
+     * A spike shorter than (N + 1) / 2 samples never reaches the output. The window is kept
+     * sorted, so an update costs N comparisons and moves, which is cheaper than a sort for the
+     * small windows used on sensor data. NaN inputs are not supported (they never compare equal).
+     */
+    template <typename T, size_t N>
+    class Median {
+
+        static_assert(N % 2 == 1, "the median window must have an odd length");
+
+        private:
+
+            T window[N];        /** Last N samples, oldest at window[oldest].   */
+            T sorted[N];        /** The same samples, sorted.                   */
+            size_t oldest;      /** Index of the oldest sample in window.       */
+
+        public:
+
+            /**
+             * @brief Construct a new Median object.
+             * @param x0 The initial value of the window.
+             */
+            constexpr Median(T x0=T()) : window(), sorted(), oldest(0) {
+
+                this->reset(x0);
+
+            }
+
+            /**
+             * @brief Updates the filter using the new input value.
+             * @param x The new input value.
+             * @return The median of the last N samples.
+             */
+            T pass(T x) {
+
+                T removed = this->window[this->oldest];
+
+                this->window[this->oldest] = x;
+                this->oldest = (this->oldest + 1 == N) ? 0 : this->oldest + 1;
+
+                // Find the removed sample, then shift the new one into place from there
+                size_t i = 0;
+
+                while (i + 1 < N && !(this->sorted[i] == removed)) {
+                    i++;
+                }
+
+                while (i > 0 && x < this->sorted[i - 1]) {
+                    this->sorted[i] = this->sorted[i - 1];
+                    i--;
+                }
+
+                while (i + 1 < N && this->sorted[i + 1] < x) {
+                    this->sorted[i] = this->sorted[i + 1];
+                    i++;
+                }
+
+                this->sorted[i] = x;
+
+                return this->sorted[N / 2];
+
+            }
+
+            /**
+             * @brief Resets the filter state.
+             * @param x0 The value the whole window is set to.
+             */
+            constexpr void reset(T x0=T()) {
+
+                for (size_t i = 0; i < N; i++) {
+                    this->window[i] = x0;
+                    this->sorted[i] = x0;
+                }
+
+                this->oldest = 0;
+
+            }
+
+    };
+
+
+#endif // FILTERBANK_HPP
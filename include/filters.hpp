@@ -3,7 +3,8 @@
     #define FILTERS_HPP
 
     /**
-     * @brief A first-order low-pass FIR filter.
+     * @brief A first-order low-pass filter (exponential smoothing, a single-pole IIR despite its
+     *        name). Higher order filters and spike rejection are in filterbank.hpp.
      */
     struct FIRFilter {
 
@@ -0,0 +1,163 @@
+#ifndef FIXED_HPP
+
+    #define FIXED_HPP
+
+    #include <stdint.h>
+    #include <limits>
+
+    /**
+     * @brief The integer type holding the exact product of two Storage values.
+     */
+    template <typename Storage> struct FixedWide;
+    template <> struct FixedWide<int16_t> { typedef int32_t type; };
+    template <> struct FixedWide<int32_t> { typedef int64_t type; };
+
+    /**
+     * @brief A signed fixed-point number with Frac fractional bits stored in a Storage integer.
+     *
+     * Every operation is integer only and saturates instead of wrapping, products and quotients
+     * are computed in the wide type and rounded to nearest, so the results are the same on every
+     * core and do not depend on the compiler or on a floating-point unit.
+     */
+    template <typename Storage, int Frac>
+    class Fixed {
+
+        static_assert(Frac > 0 && Frac < (int) sizeof(Storage) * 8, "the fractional bits must fit in the storage");
+
+        public:
+
+            typedef typename FixedWide<Storage>::type Wide;
+
+            static constexpr Wide ONE = (Wide) 1 << Frac;                           /** Raw value of 1.0.           */
+            static constexpr Storage MAX = std::numeric_limits<Storage>::max();     /** Largest raw value.          */
+            static constexpr Storage MIN = std::numeric_limits<Storage>::min();     /** Smallest raw value.         */
+
+        private:
+
+            Storage value;  /** Raw value, the number times 2^Frac. */
+
+            /**
+             * @brief Saturates a wide raw value to the storage range.
+             */
+            static constexpr Storage clamp(Wide raw) {
+
+                return (raw > MAX) ? MAX : (raw < MIN) ? MIN : (Storage) raw;
+
+            }
+
+        public:
+
+            /**
+             * @brief Construct a new Fixed object equal to 0.
+             */
+            constexpr Fixed() : value(0) {}
+
+            /**
+             * @brief Construct a new Fixed object from a real value (rounded to nearest, saturated).
+             * @param x The value.
+             */
+            constexpr Fixed(double x) : value(0) {
+
+                double scaled = x * (double) ONE;
+
+                if (scaled != scaled) {
+                    this->value = 0;
+                } else if (scaled >= (double) MAX) {
+                    this->value = MAX;
+                } else if (scaled <= (double) MIN) {
+                    this->value = MIN;
+                } else {
+                    this->value = (Storage) ((scaled < 0.0) ? scaled - 0.5 : scaled + 0.5);
+                }
+
+            }
+
+            /**
+             * @brief Creates a Fixed object from its raw value.
+             * @param raw The number times 2^Frac.
+             * @return The number.
+             */
+            static constexpr Fixed fromRaw(Storage raw) {
+
+                Fixed x;
+                x.value = raw;
+
+                return x;
+
+            }
+
+            /**
+             * @brief Gets the raw value.
+             * @return The number times 2^Frac.
+             */
+            constexpr Storage raw() const {
+
+                return this->value;
+
+            }
+
+            explicit constexpr operator double() const { return (double) this->value / (double) ONE; }
+            explicit constexpr operator float() const { return (float) ((double) this->value / (double) ONE); }
+
+            /** Truncates toward zero, like a float to int conversion. */
+            explicit constexpr operator int() const {
+
+                return (int) ((this->value < 0) ? -((-(Wide) this->value) >> Frac) : (this->value >> Frac));
+
+            }
+
+            constexpr Fixed operator+(Fixed x) const { return fromRaw(clamp((Wide) this->value + x.value)); }
+            constexpr Fixed operator-(Fixed x) const { return fromRaw(clamp((Wide) this->value - x.value)); }
+            constexpr Fixed operator-() const { return fromRaw(clamp(-(Wide) this->value)); }
+
+            constexpr Fixed operator*(Fixed x) const {
+
+                // Exact product in the wide type, rounded to nearest (ties up) when dropping Frac bits
+                Wide product = (Wide) this->value * x.value;
+
+                return fromRaw(clamp((product + ((Wide) 1 << (Frac - 1))) >> Frac));
+
+            }
+
+            constexpr Fixed operator/(Fixed x) const {
+
+                if (x.value == 0) {
+                    return fromRaw((this->value < 0) ? MIN : MAX);
+                }
+
+                // Scale the dividend in the wide type (exact), then round the quotient to nearest (ties away from 0)
+                Wide dividend = (Wide) this->value * ONE;
+                Wide quotient = dividend / x.value;
+                Wide remainder = dividend % x.value;
+
+                Wide twice = (remainder < 0) ? -2 * remainder : 2 * remainder;
+                Wide divisor = (x.value < 0) ? -(Wide) x.value : (Wide) x.value;
+
+                if (twice >= divisor) {
+                    quotient += ((dividend < 0) != (x.value < 0)) ? -1 : 1;
+                }
+
+                return fromRaw(clamp(quotient));
+
+            }
+
+            constexpr Fixed& operator+=(Fixed x) { return *this = *this + x; }
+            constexpr Fixed& operator-=(Fixed x) { return *this = *this - x; }
+            constexpr Fixed& operator*=(Fixed x) { return *this = *this * x; }
+            constexpr Fixed& operator/=(Fixed x) { return *this = *this / x; }
+
+            constexpr bool operator==(Fixed x) const { return this->value == x.value; }
+            constexpr bool operator!=(Fixed x) const { return this->value != x.value; }
+            constexpr bool operator<(Fixed x) const { return this->value < x.value; }
+            constexpr bool operator>(Fixed x) const { return this->value > x.value; }
+            constexpr bool operator<=(Fixed x) const { return this->value <= x.value; }
+            constexpr bool operator>=(Fixed x) const { return this->value >= x.value; }
+
+    };
+
+    typedef Fixed<int16_t, 15> Q15;         /** Fraction in [-1, 1), resolution 3.1e-5.             */
+    typedef Fixed<int32_t, 31> Q31;         /** Fraction in [-1, 1), resolution 4.7e-10.            */
+    typedef Fixed<int32_t, 16> Q16_16;      /** Range [-32768, 32768), resolution 1.5e-5.           */
+
+
+#endif // FIXED_HPP
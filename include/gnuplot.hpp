@@ -8,67 +8,24 @@
     #include <chrono>
     #include <thread>
     #include <string>
+    #include <atomic>
+    #include <stdint.h>
+    #include <pthread.h>
 
-    class Delay {
-        
-        private:
-            std::vector<double> data;
-            size_t oldest;
-
-        public:
-
-            // Constructor initializes the buffer with zeros
-            Delay() {}
-
-            // Constructor initializes the buffer with initial data
-            Delay(const std::vector<double>& initialData) {
-
-                data = initialData;
-                oldest = 0;
-
-            }
+    #include "ringbuffer.hpp"
 
-            // Copy constructor
-            Delay(const Delay& other) {
+    #define GNUPLOT_MAX_POINTS 256  /** Capacity of the sample ring, the largest buffer_size (a power of two). */
 
-                data = other.data;
-                oldest = other.oldest;
+    // A sample as sent to gnuplot, one binary record of two floats
+    struct PlotPoint {
 
-            }
-
-            // Assingment operator
-            Delay& operator=(const std::vector<double>& initialData) {
-
-                data = initialData;
-                oldest = 0;
+        float x;    /** Time in seconds.    */
+        float y;    /** Value.              */
 
-                return *this;
-
-            }
-
-            // Add a new data point to the buffer
-            void add(double value) {
-
-                data[oldest] = value;
-                oldest = (oldest + 1) % data.size();
-
-            }
-
-            // Get the value at the specified index where the specified index is 0 for the oldest value
-            float operator[](size_t index) const {
-
-                return data[(oldest + index) % data.size()];
-
-            }
-
-            size_t size() const {
-
-                return data.size();
-
-            }
-    
     };
 
+    static_assert(sizeof(PlotPoint) == 2 * sizeof(float), "PlotPoint must be a packed (x, y) record");
+
 
     class GNUPlot {
 
@@ -78,16 +35,26 @@
             std::string xlabel;
             std::string ylabel;
             FILE* gnuplotPipe = nullptr;
-            double start_time;
+            std::chrono::steady_clock::time_point start_time;
             double update_rate;
-            Delay xData;
-            Delay yData;
-            bool running;
+            float min;
+            float max;
+            bool threaded;
+            std::atomic<bool> running;
             std::thread plot_thread;
 
+            // Samples written by add() and copied by refresh(), the writer never waits on the plot
+            size_t buffer_size;
+            RingBuffer<PlotPoint, GNUPLOT_MAX_POINTS> points;
+
+            // Preallocated snapshot sent as binary (x, y) records, and the commands around it
+            std::vector<PlotPoint> frame;
+            std::string plotCommand;
+            uint64_t drawn;
+
         public:
         
-            GNUPlot(const std::string& title, const std::string& label, float min, float max, size_t buffer_size, double update_rate) {
+            GNUPlot(const std::string& title, const std::string& label, float min, float max, size_t buffer_size, double update_rate, bool threaded=true) {
         
                 // Open pipe to GNUplot
                 gnuplotPipe = popen("gnuplot -persist", "w");
@@ -105,56 +72,45 @@
                     this->xlabel = "time (s)";
                     this->ylabel = label;
 
-                    // Initialize data buffer
-                    xData = std::vector<double>(buffer_size, 0);
-                    yData = std::vector<double>(buffer_size, 0);
-
                     // Get start time
-                    this->start_time  = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+                    this->start_time  = std::chrono::steady_clock::now();
                     this->update_rate = update_rate;
 
-                    std::vector<double> time(buffer_size, 0.0f);
-                    std::vector<double> data(buffer_size, 0.0f);
-
-                    // Fill buffer with initial data
-                    for (size_t i = 0; i < buffer_size; ++i) {
-                        
-                        time[i] = - (float) (buffer_size - i) * update_rate;
-                        data[i] = 0.0f;
+                    // Initialize the data buffer with a history of zeros ending now
+                    this->buffer_size = (buffer_size < GNUPLOT_MAX_POINTS) ? buffer_size : GNUPLOT_MAX_POINTS;
 
+                    for (size_t i = 0; i < this->buffer_size; ++i) {
+                        this->points.push({ - (float) (this->buffer_size - i) * (float) update_rate, 0.0f });
                     }
 
-                    // Initialize the delays
-                    xData = Delay(time);
-                    yData = Delay(data);
+                    this->drawn = UINT64_MAX;
+
+                    this->frame = std::vector<PlotPoint>(this->buffer_size, PlotPoint{ 0.0f, 0.0f });
+                    this->plotCommand = "plot '-' binary record=" + std::to_string(this->buffer_size) + " format='%float%float' using 1:2 with linespoints notitle\n";
 
-                    // Start the plot thread
+                    this->min = min;
+                    this->max = max;
+
+                    // Start the plot thread, or let the owner call refresh() periodically
+                    this->threaded = threaded;
                     this->running = true;
+
+                    if (!threaded) {
+
+                        this->setup();
+                        return;
+
+                    }
                     
-                    this->plot_thread = std::thread([this, min, max] {
+                    this->plot_thread = std::thread([this] {
                         
-                        // Initialize GNUplot settings
-                        this->sendCommand("set title '"  + this->title  + "'");
-                        this->sendCommand("set xlabel '" + this->xlabel + "'");
-                        this->sendCommand("set ylabel '" + this->ylabel + "'");
-                        this->sendCommand("set grid");
-                        this->sendCommand("set term x11");
-                        this->sendCommand("set style data linespoints");
-                        this->sendCommand("set xrange [" + std::to_string(this->xData[0]) + ":" + std::to_string(xData[this->xData.size() - 1]) + "]");
-                        this->sendCommand("set yrange [" + std::to_string(min) + ":" + std::to_string(max) + "]");
+                        this->setup();
 
                         while (this->running) {
                             
-                            this->sendCommand("set xrange [" + std::to_string(this->xData[0]) + ":" + std::to_string(this->xData[this->xData.size() - 1]) + "]");
-                            this->sendCommand("plot '-' with linespoints");
-
-                            for (size_t i = 0; i < xData.size(); ++i) {
-                                fprintf(this->gnuplotPipe, "%f %f\n", this->xData[i], this->yData[i]);
-                            }
-
-                            this->sendCommand("e"); // End of dataset
+                            this->refresh();
 
-                            std::this_thread::sleep_for(std::chrono::milliseconds((int) this->update_rate*1000));
+                            std::this_thread::sleep_for(std::chrono::milliseconds((int) (this->update_rate * 1000)));
 
                         }
 
@@ -167,12 +123,72 @@
             }
 
 
+            // Initialize GNUplot settings
+            void setup() {
+
+                this->snapshot();
+
+                this->sendCommand("set title '"  + this->title  + "'");
+                this->sendCommand("set xlabel '" + this->xlabel + "'");
+                this->sendCommand("set ylabel '" + this->ylabel + "'");
+                this->sendCommand("set grid");
+                this->sendCommand("set term x11");
+                this->sendCommand("set style data linespoints");
+                this->sendCommand("set xrange [" + std::to_string(this->frame[0].x) + ":" + std::to_string(this->frame[this->buffer_size - 1].x) + "]");
+                this->sendCommand("set yrange [" + std::to_string(this->min) + ":" + std::to_string(this->max) + "]");
+
+            }
+
+
+            // Copy the most recent samples, oldest first, into the frame buffer
+            uint64_t snapshot() {
+
+                uint64_t count;
+
+                // Samples overwritten during the copy are dropped, copy again to draw a full frame
+                do {
+                    count = this->points.count();
+                } while (this->points.snapshot(this->frame.data(), this->buffer_size) < this->buffer_size);
+
+                return count;
+
+            }
+
+
+            // Redraw the plot if new samples arrived since the last redraw
+            void refresh() {
+
+                uint64_t current = this->points.count();
+
+                if (current == this->drawn || this->gnuplotPipe == nullptr) {
+                    return;
+                }
+
+                this->drawn = this->snapshot();
+
+                char range[64];
+                int length = snprintf(range, sizeof(range), "set xrange [%f:%f]\n", this->frame[0].x, this->frame[this->buffer_size - 1].x);
+
+                fwrite(range, 1, length, this->gnuplotPipe);
+                fwrite(this->plotCommand.data(), 1, this->plotCommand.size(), this->gnuplotPipe);
+                fwrite(this->frame.data(), sizeof(PlotPoint), this->frame.size(), this->gnuplotPipe);
+                fflush(this->gnuplotPipe);
+
+            }
+
+
             void disconnect() {
 
                 if (this->running) {
                     
                     this->running = false;
-                    this->plot_thread.join();
+
+                    if (this->threaded) {
+                        this->plot_thread.join();
+                    } else {
+                        this->sendCommand("quit");
+                    }
+
                     pclose(gnuplotPipe);
                     gnuplotPipe = nullptr;
                 
@@ -201,14 +217,20 @@
             
             }
 
+            // Get the native handle of the plot thread (e.g. to set its priority or affinity)
+            pthread_t nativeHandle() {
+
+                return this->plot_thread.native_handle();
+
+            }
+
+            // Add a data point (single writer, never blocks on the plot thread)
             void add(double x) {
 
                 // Get current time
-                double current_time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+                float current_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - this->start_time).count();
 
-                // Add data point to buffer
-                xData.add(current_time - start_time);
-                yData.add(x);
+                this->points.push({ current_time, (float) x });
 		
             }
 
@@ -0,0 +1,96 @@
+#ifndef GPIO_HPP
+
+    #define GPIO_HPP
+
+    #include <gpiod.h>
+
+    #define GPIO_MAX_LINES 8        /** Most lines held by a GPIOLines request. */
+
+    /**
+     * @brief A set of output lines of a GPIO chip, requested in a single call and released when
+     *        the object is destroyed.
+     *
+     * The lines of a request can only be driven together (setting a subset drives the others
+     * low), so every write sets the whole bulk from a shadow copy of the line values, and a write
+     * that does not change any value is skipped without an ioctl.
+     */
+    class GPIOLines {
+
+        private:
+
+            struct gpiod_line_bulk bulk;    /** The requested lines, empty if not requested.   */
+            int values[GPIO_MAX_LINES];     /** Shadow copy of the line values.                */
+            bool known;                     /** Whether the shadow copy matches the lines.     */
+
+        public:
+
+            /**
+             * @brief Construct a new GPIOLines object (does nothing, use request() to claim lines).
+             */
+            GPIOLines();
+
+            // Prevent copy and assignment
+            GPIOLines(const GPIOLines&) = delete;
+            GPIOLines& operator=(const GPIOLines&) = delete;
+
+            /**
+             * @brief Requests lines of a chip as outputs in a single call, releasing the lines held before.
+             * @param chip The GPIO chip.
+             * @param offsets The offsets of the lines on the chip.
+             * @param defaults The initial values of the lines.
+             * @param count The number of lines, at most GPIO_MAX_LINES.
+             * @param consumer The consumer name shown by the kernel.
+             * @return True if the lines were requested, false otherwise.
+             */
+            bool request(struct gpiod_chip* chip, const unsigned int offsets[], const int defaults[], unsigned int count, const char* consumer);
+
+            /**
+             * @brief Sets all the lines in a single call unless they already hold the values.
+             * @param values The values of the lines, in request order.
+             * @return 1 if the lines were written, 0 if the write was skipped, -1 on failure.
+             */
+            int set(const int values[]);
+
+            /**
+             * @brief Sets one line, writing the whole bulk with the other lines unchanged.
+             * @param index The index of the line in request order.
+             * @param value The value of the line.
+             * @return 1 if the lines were written, 0 if the write was skipped, -1 on failure.
+             */
+            int set(unsigned int index, int value);
+
+            /**
+             * @brief Gets the shadow value of a line.
+             * @param index The index of the line in request order.
+             * @return The last value written, -1 if unknown.
+             */
+            int get(unsigned int index) const;
+
+            /**
+             * @brief Forgets the shadow copy so the next write is sent unconditionally.
+             */
+            void invalidate();
+
+            /**
+             * @brief Gets the number of requested lines.
+             * @return The number of lines, 0 if not requested.
+             */
+            unsigned int size() const;
+
+            /**
+             * @brief Checks if the lines are requested.
+             * @return True if the lines are requested, false otherwise.
+             */
+            bool isRequested() const;
+
+            /**
+             * @brief Releases the lines (does nothing if not requested).
+             */
+            void release();
+
+            ~GPIOLines();
+
+    };
+
+
+#endif // GPIO_HPP
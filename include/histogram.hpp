@@ -0,0 +1,139 @@
+#ifndef HISTOGRAM_HPP
+
+    #define HISTOGRAM_HPP
+
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <atomic>
+
+    #define HISTOGRAM_SUB_BITS 4                                /** log2 of the sub-buckets per power of two. */
+    #define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)       /** Sub-buckets per power of two (~6% error). */
+    #define HISTOGRAM_BUCKETS (64 * HISTOGRAM_SUB_COUNT)        /** Buckets covering the full uint64_t range. */
+
+    /**
+     * @brief A lock-free log-linear (HDR-style) latency histogram.
+     *
+     * Values below HISTOGRAM_SUB_COUNT get their own bucket, larger values are split in
+     * HISTOGRAM_SUB_COUNT buckets per power of two, which bounds the relative error of the
+     * reported percentiles. Recording is wait-free and meant for a single writer thread, any
+     * other thread can read or dump the histogram at any time.
+     */
+    class LatencyHistogram {
+
+        private:
+
+            std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS];    /** Number of samples per bucket.   */
+            std::atomic<uint64_t> count;                        /** Total number of samples.        */
+            std::atomic<uint64_t> sum;                          /** Sum of all samples.             */
+            std::atomic<uint64_t> min;                          /** Smallest sample.                */
+            std::atomic<uint64_t> max;                          /** Largest sample.                 */
+
+        public:
+
+            /**
+             * @brief Construct a new empty LatencyHistogram object.
+             */
+            LatencyHistogram();
+
+            // Prevent copy and assignment
+            LatencyHistogram(const LatencyHistogram&) = delete;
+            LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+            /**
+             * @brief Gets the bucket of a value.
+             * @param value The value.
+             * @return The bucket index.
+             */
+            static int bucketOf(uint64_t value) {
+
+                if (value < HISTOGRAM_SUB_COUNT) {
+                    return (int) value;
+                }
+
+                int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+
+                return (shift + 1) * HISTOGRAM_SUB_COUNT + (int) ((value >> shift) & (HISTOGRAM_SUB_COUNT - 1));
+
+            }
+
+            /**
+             * @brief Gets the largest value that falls in a bucket.
+             * @param bucket The bucket index.
+             * @return The upper bound of the bucket.
+             */
+            static uint64_t upperBoundOf(int bucket);
+
+            /**
+             * @brief Records a sample (single writer).
+             * @param value The sample, typically a duration in nanoseconds.
+             */
+            void record(uint64_t value) {
+
+                this->counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+                this->count.fetch_add(1, std::memory_order_relaxed);
+                this->sum.fetch_add(value, std::memory_order_relaxed);
+
+                if (value < this->min.load(std::memory_order_relaxed)) {
+                    this->min.store(value, std::memory_order_relaxed);
+                }
+
+                if (value > this->max.load(std::memory_order_relaxed)) {
+                    this->max.store(value, std::memory_order_relaxed);
+                }
+
+            }
+
+            /**
+             * @brief Gets the value below which a fraction of the samples fall.
+             * @param fraction The fraction in the range [0, 1] (e.g. 0.99 for p99).
+             * @return The upper bound of the bucket holding the percentile, 0 if empty.
+             */
+            uint64_t percentile(double fraction) const;
+
+            /**
+             * @brief Gets the number of samples.
+             * @return The number of samples.
+             */
+            uint64_t getCount() const;
+
+            /**
+             * @brief Gets the mean of the samples.
+             * @return The mean, 0 if empty.
+             */
+            double getMean() const;
+
+            /**
+             * @brief Gets the smallest sample.
+             * @return The smallest sample, 0 if empty.
+             */
+            uint64_t getMin() const;
+
+            /**
+             * @brief Gets the largest sample.
+             * @return The largest sample.
+             */
+            uint64_t getMax() const;
+
+            /**
+             * @brief Clears all the samples.
+             */
+            void reset();
+
+            /**
+             * @brief Writes the summary of the histogram as one line of text.
+             * Format: name count min p50 p90 p99 p99.9 max mean, with durations in nanoseconds.
+             * @param file The file to write to.
+             * @param name The name of the line (without spaces).
+             */
+            void dump(FILE* file, const char* name) const;
+
+            /**
+             * @brief Writes the header line matching dump().
+             * @param file The file to write to.
+             */
+            static void dumpHeader(FILE* file);
+
+    };
+
+
+#endif // HISTOGRAM_HPP
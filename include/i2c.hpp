@@ -0,0 +1,75 @@
+#ifndef I2C_HPP
+
+    #define I2C_HPP
+
+    #include <stdint.h>
+
+    extern "C" {
+    #include <linux/i2c.h>
+    }
+
+    /**
+     * The I2C transport of the PiCar-X. Every bus access of PiCarX goes through these functions,
+     * implemented on the i2c-dev driver by src/i2c.cpp. The benchmarks link bench/sim/simbus.cpp
+     * instead, which answers like the MCU without any hardware.
+     */
+
+    /**
+     * @brief Swaps the bytes of a word (the MCU expects the high byte first, SMBus sends the low byte first).
+     * @param value The word.
+     * @return The word with its bytes swapped.
+     */
+    constexpr uint16_t i2cSwapBytes(uint16_t value) {
+
+        return (uint16_t) (((value & 0xff) << 8) | (value >> 8));
+
+    }
+
+    /**
+     * @brief Opens an I2C bus.
+     * @param path The path of the bus device (e.g. /dev/i2c-1).
+     * @return The file descriptor, negative on failure.
+     */
+    int i2cOpen(const char* path);
+
+    /**
+     * @brief Sets the address of the device the next SMBus calls talk to.
+     * @param fd The file descriptor of the bus.
+     * @param address The 7-bit device address.
+     * @return Negative on failure.
+     */
+    int i2cSetAddress(int fd, uint16_t address);
+
+    /**
+     * @brief Runs messages in a single combined transaction (repeated starts, I2C_RDWR).
+     * @param fd The file descriptor of the bus.
+     * @param msgs The messages, read messages receive the data.
+     * @param count The number of messages.
+     * @return Negative on failure.
+     */
+    int i2cTransfer(int fd, struct i2c_msg msgs[], uint32_t count);
+
+    /**
+     * @brief Writes a word to a register (SMBus write word data, low byte first).
+     * @param fd The file descriptor of the bus.
+     * @param reg The register.
+     * @param value The word.
+     * @return Negative on failure.
+     */
+    int i2cWriteWord(int fd, uint8_t reg, uint16_t value);
+
+    /**
+     * @brief Reads a byte (SMBus receive byte).
+     * @param fd The file descriptor of the bus.
+     * @return The byte, negative on failure.
+     */
+    int i2cReadByte(int fd);
+
+    /**
+     * @brief Closes an I2C bus.
+     * @param fd The file descriptor of the bus.
+     */
+    void i2cClose(int fd);
+
+
+#endif // I2C_HPP
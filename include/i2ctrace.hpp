@@ -0,0 +1,209 @@
+#ifndef I2CTRACE_HPP
+
+    #define I2CTRACE_HPP
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <atomic>
+
+    extern "C" {
+    #include <linux/i2c.h>
+    }
+
+    // Compiled in unless built with -DI2C_TRACE=0 (make I2C_TRACE=0), then enabled at runtime
+    #ifndef I2C_TRACE
+        #define I2C_TRACE 1
+    #endif
+
+    #define I2C_TRACE_RING 4096             /** Transactions kept (a power of two).            */
+    #define I2C_TRACE_REGISTERS 256         /** Size of the MCU register address space.        */
+
+    #define I2C_TRACE_TRANSFER 0            /** Combined transaction (i2cTransfer).            */
+    #define I2C_TRACE_WRITE_WORD 1          /** SMBus write word (i2cWriteWord).               */
+    #define I2C_TRACE_READ_BYTE 2           /** SMBus receive byte (i2cReadByte).              */
+
+    #define I2C_TRACE_READ (1 << 0)         /** The transaction read data from the device.     */
+
+    /**
+     * @brief One call of the I2C transport (24 bytes).
+     */
+    struct I2CTransaction {
+
+        uint64_t start;                     /** Monotonic start time in nanoseconds.                    */
+        uint32_t duration_ns;               /** Time spent in the call.                                 */
+        int32_t result;                     /** Return value of the call, negative on failure.          */
+        uint16_t bytes;                     /** Bytes on the wire, device addresses excluded.           */
+        uint8_t reg;                        /** Register of the first message.                          */
+        uint8_t messages;                   /** Number of messages.                                     */
+        uint8_t kind;                       /** I2C_TRACE_TRANSFER, I2C_TRACE_WRITE_WORD or _READ_BYTE. */
+        uint8_t flags;                      /** I2C_TRACE_* flags.                                      */
+        uint8_t reserved[2];                /** Zero.                                                   */
+
+    };
+
+    /**
+     * @brief The traffic of one register since the last reset.
+     */
+    struct I2CRegisterStats {
+
+        uint64_t calls;                     /** Messages addressed to the register.                     */
+        uint64_t errors;                    /** Messages of failed transactions.                        */
+        uint64_t bytes;                     /** Bytes on the wire.                                      */
+        uint64_t bus_ns;                    /** Share of the transaction times (see I2CTracer).         */
+        uint64_t max_ns;                    /** Longest transaction the register was part of.           */
+
+    };
+
+    /**
+     * @brief Records the calls of the I2C transport (src/i2c.cpp).
+     *
+     * Every call is timestamped and written into a ring of the most recent transactions, and added
+     * to per-register counters. A combined transaction counts once per message: a read message is
+     * accounted to the register written by the message before it (the register it reads), and the
+     * duration is split evenly between the messages, so the bus times of the registers add up to
+     * the time spent on the bus. The sensor, actuation and background threads all use the bus, so
+     * the ring takes several writers: a writer claims an index with an atomic increment and stamps
+     * its slot with it while writing (odd) and once written (even), so readers skip the slots still
+     * being written or already reused. Only a writer stalled for a whole lap of the ring could
+     * publish a mixed slot. Nothing locks or allocates, and a disabled tracer costs one relaxed load
+     * per call.
+     */
+    class I2CTracer {
+
+        private:
+
+            static const size_t WORDS = (sizeof(I2CTransaction) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+            /**
+             * @brief A transaction of the ring, stored as relaxed atomic words.
+             */
+            struct Slot {
+
+                std::atomic<uint64_t> sequence;     /** 2 * index + 1 while written, 2 * index + 2 once written.    */
+                std::atomic<uint64_t> words[WORDS]; /** The transaction.                                            */
+
+            };
+
+            std::atomic<bool> enabled;                                      /** Whether calls are recorded.                 */
+            std::atomic<uint64_t> head;                                     /** Transactions recorded so far.               */
+            Slot slots[I2C_TRACE_RING];                                     /** The most recent transactions.               */
+            std::atomic<uint64_t> calls[I2C_TRACE_REGISTERS];               /** See I2CRegisterStats.                       */
+            std::atomic<uint64_t> errors[I2C_TRACE_REGISTERS];
+            std::atomic<uint64_t> bytes[I2C_TRACE_REGISTERS];
+            std::atomic<uint64_t> bus_ns[I2C_TRACE_REGISTERS];
+            std::atomic<uint64_t> max_ns[I2C_TRACE_REGISTERS];
+            std::atomic<uint8_t> addressed;                                 /** Register of the last SMBus write.           */
+
+            /**
+             * @brief Adds a message to the counters of a register.
+             */
+            void account(uint8_t reg, uint16_t bytes, uint64_t share_ns, uint64_t duration_ns, bool failed);
+
+            /**
+             * @brief Writes a transaction into the next slot of the ring.
+             */
+            void store(const I2CTransaction& transaction);
+
+            /**
+             * @brief Reads the transaction with the given index if it is still in the ring.
+             * @return False if the slot was overwritten or is still being written.
+             */
+            bool read(uint64_t index, I2CTransaction& transaction) const;
+
+        public:
+
+            /**
+             * @brief Construct a new I2CTracer object (disabled).
+             */
+            I2CTracer();
+
+            // Prevent copy and assignment
+            I2CTracer(const I2CTracer&) = delete;
+            I2CTracer& operator=(const I2CTracer&) = delete;
+
+            /**
+             * @brief Starts or stops recording (stays stopped in builds with I2C_TRACE 0).
+             * @param enabled True to record the calls of the transport.
+             */
+            void setEnabled(bool enabled);
+
+            /**
+             * @brief Checks if the calls are recorded.
+             * @return True if the tracer records, false otherwise.
+             */
+            bool isEnabled() const {
+
+                return this->enabled.load(std::memory_order_relaxed);
+
+            }
+
+            /**
+             * @brief Records a combined transaction.
+             * @param msgs The messages of the transaction.
+             * @param count The number of messages.
+             * @param start The monotonic time before the call in nanoseconds.
+             * @param end The monotonic time after the call in nanoseconds.
+             * @param result The return value of the call.
+             */
+            void recordTransfer(const struct i2c_msg msgs[], uint32_t count, uint64_t start, uint64_t end, int result);
+
+            /**
+             * @brief Records an SMBus write word.
+             * @param reg The register written.
+             * @param start The monotonic time before the call in nanoseconds.
+             * @param end The monotonic time after the call in nanoseconds.
+             * @param result The return value of the call.
+             */
+            void recordWriteWord(uint8_t reg, uint64_t start, uint64_t end, int result);
+
+            /**
+             * @brief Records an SMBus receive byte, accounted to the register of the last SMBus write.
+             * @param start The monotonic time before the call in nanoseconds.
+             * @param end The monotonic time after the call in nanoseconds.
+             * @param result The return value of the call.
+             */
+            void recordReadByte(uint64_t start, uint64_t end, int result);
+
+            /**
+             * @brief Copies the most recent transactions, oldest first.
+             * @param out Receives the transactions.
+             * @param count The number of transactions wanted (at most I2C_TRACE_RING).
+             * @return The number of transactions copied, less than count if fewer are available
+             *         or some were overwritten during the copy.
+             */
+            size_t snapshot(I2CTransaction out[], size_t count) const;
+
+            /**
+             * @brief Gets the traffic of a register.
+             * @param reg The register.
+             * @return The counters since the last reset.
+             */
+            I2CRegisterStats getRegisterStats(uint8_t reg) const;
+
+            /**
+             * @brief Gets the number of transactions recorded.
+             * @return The number of transactions since the last reset.
+             */
+            uint64_t getCount() const;
+
+            /**
+             * @brief Clears the counters and the ring (not while the transport is in use).
+             */
+            void reset();
+
+            /**
+             * @brief Writes the per-register counters and the transactions of the ring to a text file.
+             * @param path The path of the file.
+             * @return True if the file was written, false otherwise.
+             */
+            bool dump(const char* path) const;
+
+    };
+
+    /**
+     * @brief The tracer of the I2C transport.
+     */
+    extern I2CTracer i2c_tracer;
+
+
+#endif // I2CTRACE_HPP
@@ -0,0 +1,70 @@
+#ifndef LOGTABLE_HPP
+
+    #define LOGTABLE_HPP
+
+    #include <stdint.h>
+
+    #include "constmath.hpp"
+
+    #define LOG_TABLE_SIZE 4096     /** One entry per 12-bit ADC code. */
+
+    /**
+     * @brief A table of log(raw * scale + bias) for every 12-bit ADC code.
+     *
+     * logdiffRaw(a, b) replaces logdiff(toVoltage(a) * gain, toVoltage(b) * gain, bias) by two
+     * loads and a subtraction. The table is built by the compiler when the object is constexpr,
+     * and can also be built at run time (e.g. when the bias changes).
+     *
+     * Error bound: every entry is the float nearest to the logarithm (<= 0.5 float ulp, 1.2e-7
+     * for the values of the line sensors), the subtraction adds at most 0.5 ulp of the result and
+     * logdiff itself rounds its float inputs, so |logdiffRaw - logdiff| <= 1e-6 over every pair of
+     * codes. The bound is checked by bench/logtable.
+     */
+    class LogTable {
+
+        private:
+
+            float table[LOG_TABLE_SIZE];    /** log(raw * scale + bias) indexed by raw. */
+
+        public:
+
+            /**
+             * @brief Construct a new LogTable object.
+             * @param scale The value of one ADC code (e.g. ADC_VREF / ADC_RESO * gain).
+             * @param bias The bias added before the logarithm.
+             */
+            constexpr LogTable(double scale, double bias) : table() {
+
+                for (int raw = 0; raw < LOG_TABLE_SIZE; raw++) {
+                    this->table[raw] = (float) constLog(raw * scale + bias);
+                }
+
+            }
+
+            /**
+             * @brief Gets the logarithm of a code.
+             * @param raw The raw ADC code (codes above 4095 read the last entry).
+             * @return log(raw * scale + bias).
+             */
+            constexpr float log(uint16_t raw) const {
+
+                return this->table[(raw < LOG_TABLE_SIZE) ? raw : LOG_TABLE_SIZE - 1];
+
+            }
+
+            /**
+             * @brief Calculates the difference of logarithms of two raw codes.
+             * @param a The first raw ADC code.
+             * @param b The second raw ADC code.
+             * @return log(a * scale + bias) - log(b * scale + bias).
+             */
+            constexpr float logdiffRaw(uint16_t a, uint16_t b) const {
+
+                return this->log(a) - this->log(b);
+
+            }
+
+    };
+
+
+#endif // LOGTABLE_HPP
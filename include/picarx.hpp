@@ -3,22 +3,146 @@
     #define PICARX_HPP
 
     #include <stdint.h>
+    #include <stddef.h>
     #include <gpiod.h>
 
+    #include "gpio.hpp"
+
     #define A0 0x17
     #define A1 0x16
     #define A2 0x15
     #define A3 0x14
 
+    #define ADC_CHANNELS  5         /** Number of ADC channels (A0-A3 and battery). */
+    #define ADC_VREF      3.3       /** ADC reference voltage.                      */
+    #define ADC_RESO      4095.0    /** Largest 12-bit ADC code.                    */
+
+    #define LINE_SENSOR_GAIN 5.7f   /** Gain applied to the line sensor voltages before the log difference.   */
+    #define LOG_DIFF_BIAS 0.25f     /** Default bias added to the sensor voltages before the log.             */
+
+    #define ADC_IDX_A0    0
+    #define ADC_IDX_A1    1
+    #define ADC_IDX_A2    2
+    #define ADC_IDX_A3    3
+    #define ADC_IDX_BATT  4
+
+    #define ADC_MASK_A0   (1 << ADC_IDX_A0)
+    #define ADC_MASK_A1   (1 << ADC_IDX_A1)
+    #define ADC_MASK_A2   (1 << ADC_IDX_A2)
+    #define ADC_MASK_A3   (1 << ADC_IDX_A3)
+    #define ADC_MASK_BATT (1 << ADC_IDX_BATT)
+    #define ADC_MASK_ALL  0x1F
+
+    #define MCU_REGISTERS 256       /** Size of the MCU register address space. */
+
+    /**
+     * @brief Counters of the actuator writes filtered by the shadow register cache.
+     */
+    struct WriteStats {
+
+        uint64_t register_writes;   /** Register writes sent to the MCU.                 */
+        uint64_t register_skips;    /** Register writes skipped because nothing changed. */
+        uint64_t gpio_writes;       /** GPIO line writes sent to the chip.               */
+        uint64_t gpio_skips;        /** GPIO line writes skipped because nothing changed. */
+        uint64_t gpio_errors;       /** GPIO line writes that failed.                    */
+
+    };
+
+    /**
+     * @brief A snapshot of ADC channels acquired in a single transaction.
+     */
+    struct SensorFrame {
+
+        uint64_t timestamp;             /** Monotonic acquisition time in nanoseconds.   */
+        uint8_t mask;                   /** Channels present in the frame (ADC_MASK_*).  */
+        uint16_t raw[ADC_CHANNELS];     /** Raw 12-bit ADC codes indexed by ADC_IDX_*.   */
+
+    };
+
+    /**
+     * @brief The actuator commands of one control cycle.
+     */
+    struct ActuatorFrame {
+
+        float speed;    /** The speed of the motors in the range [-1, 1].   */
+        float angle;    /** The steering angle in the range [-30; 30].      */
+
+    };
+
+    /**
+     * @brief The linear map from a steering angle to the pulse width of the servo, in PWM ticks.
+     */
+    struct SteeringMap {
+
+        float min_angle;            /** Smallest steering angle, lower angles saturate. */
+        float max_angle;            /** Largest steering angle, higher angles saturate. */
+        double ticks_at_zero;       /** Pulse width of the 0 degree angle.              */
+        double ticks_per_degree;    /** Pulse width added by each degree.               */
+
+    };
+
     class PiCarX {
             
         private:
 
             int i2cfd;                          /** I2C file descriptor.                           */
             struct gpiod_chip *gpio;            /** GPIO chip file connection.                     */
-            struct gpiod_line *mot1_dir_line;   /** GPIO line to control the direction of motor 1. */
-            struct gpiod_line *mot2_dir_line;   /** GPIO line to control the direction of motor 2. */
-            struct gpiod_line *mcu_rst_line;    /** GPIO line to reset the MCU.                    */
+            GPIOLines lines;                    /** Motor direction and MCU reset lines.           */
+
+            uint16_t registers[MCU_REGISTERS];  /** Shadow copy of the MCU registers.              */
+            bool registers_known[MCU_REGISTERS];/** Whether the shadow register matches the MCU.   */
+            WriteStats stats;                   /** Shadow cache write counters.                   */
+            bool warm;                          /** Whether the last connect kept the MCU running. */
+
+            /**
+             * @brief Writes registers of the MCU in a single I2C transaction, skipping those whose
+             *        shadow copy already holds the value. More than MAX_BATCHED_WRITES changed
+             *        registers are split into consecutive transactions.
+             * @param regs The registers to write.
+             * @param values The values to write.
+             * @param count The number of registers to write.
+             * @return False if a transaction was not acknowledged.
+            */
+            bool writeRegisters(const uint8_t regs[], const uint16_t values[], int count);
+
+            /**
+             * @brief Sends a batch of register writes in one transaction and updates their shadow state.
+             * @param msgs The write messages.
+             * @param dirty The register of every message.
+             * @param count The number of messages (at most MAX_BATCHED_WRITES).
+             * @return False if the MCU did not acknowledge the transaction.
+            */
+            bool transferWrites(struct i2c_msg msgs[], const uint8_t dirty[], uint32_t count);
+
+            /**
+             * @brief Writes a register of the MCU unless the shadow copy already holds the value.
+             * @param reg The register to write.
+             * @param value The value to write.
+            */
+            void writeRegister(uint8_t reg, uint16_t value);
+
+            /**
+             * @brief Sets both motor direction lines in a single call unless they already hold the values.
+             * @param direction The direction of motor 1 (motor 2 is driven with the opposite value).
+            */
+            void setDirection(int direction);
+
+            /**
+             * @brief Pulses the MCU reset line, leaving the MCU running.
+             * @param direction The value the motor direction lines are held at during the pulse.
+            */
+            void pulseReset(int direction);
+
+            /**
+             * @brief Checks that the MCU answers on the bus with a plausible battery reading.
+             * @return True if the MCU is running, false otherwise.
+            */
+            bool probe();
+
+            /**
+             * @brief Programs the PWM timers and stops the motors and the steering in a single I2C transaction.
+            */
+            void configure();
 
         public:
 
@@ -29,8 +153,17 @@
 
             /**
              * @brief Connects to the PiCar-X.
+             * @param warm If true and the MCU still runs from a previous connection (see disconnect),
+             *             keep it running instead of pulsing its reset line. Falls back to a reset
+             *             when the MCU does not answer.
             */
-            void connect();
+            void connect(bool warm=false);
+
+            /**
+             * @brief Checks if the last connect kept the MCU running.
+             * @return True if the reset pulse was skipped, false otherwise.
+            */
+            bool isWarmStart();
 
             /**
              * @brief Sets the speed of the motors.
@@ -44,6 +177,12 @@
             */
             void setSteeringAngle(float angle);
 
+            /**
+             * @brief Sets the speed of the motors and the steering angle in a single I2C transaction.
+             * @param frame The motor speed and steering angle to apply.
+            */
+            void applyActuatorFrame(const ActuatorFrame& frame);
+
             /**
              * @brief Reads the analog voltage from the specified channel.
              * @param channel The channel to read from (A0, A1, A2, A3).
@@ -57,16 +196,85 @@
             */
             float getBatteryVoltage();
 
+            /**
+             * @brief Reads a set of ADC channels in a single combined I2C transaction.
+             * @param mask The channels to read (bitwise or of ADC_MASK_*).
+             * @param out The raw 12-bit ADC codes indexed by ADC_IDX_*. Entries not selected by the
+             *            mask are left untouched.
+             * @param timestamp If not NULL, receives the monotonic acquisition time in nanoseconds.
+             * @return True if the transaction succeeded, false otherwise.
+            */
+            bool readChannelsRaw(uint8_t mask, uint16_t out[ADC_CHANNELS], uint64_t* timestamp=NULL);
+
+            /**
+             * @brief Reads a set of ADC channels in a single combined I2C transaction.
+             * @param mask The channels to read (bitwise or of ADC_MASK_*).
+             * @param out The voltages indexed by ADC_IDX_*, A0-A3 in [0, 3.3] V and BATT in [0, 9.9] V.
+             *            Entries not selected by the mask are left untouched.
+             * @param timestamp If not NULL, receives the monotonic acquisition time in nanoseconds.
+             * @return True if the transaction succeeded, false otherwise.
+            */
+            bool readChannels(uint8_t mask, float out[ADC_CHANNELS], uint64_t* timestamp=NULL);
+
+            /**
+             * @brief Reads a set of ADC channels in a single combined I2C transaction. Reads only share
+             *        the I2C file descriptor, so they can run on several threads and alongside actuation.
+             * @param mask The channels to read (bitwise or of ADC_MASK_*).
+             * @param frame The frame receiving the raw codes, the mask and the acquisition time.
+             * @return True if the transaction succeeded, false otherwise.
+            */
+            bool readFrame(uint8_t mask, SensorFrame& frame);
+
+            /**
+             * @brief Converts a raw ADC code to a voltage.
+             * @param index The channel the code was read from (ADC_IDX_*).
+             * @param raw The raw 12-bit ADC code.
+             * @return The voltage, in [0, 3.3] V for A0-A3 and in [0, 9.9] V for BATT.
+            */
+            static float toVoltage(int index, uint16_t raw);
+
+            /**
+             * @brief Computes the pulse width the steering servo is driven with for an angle.
+             * @param angle The steering angle, saturated to [-30, 30].
+             * @return The pulse width in PWM ticks.
+            */
+            static uint16_t steeringPulseWidth(float angle);
+
+            /**
+             * @brief Gets the map from steering angles to pulse widths (e.g. for an integer control path).
+             * @return The steering map.
+            */
+            static SteeringMap steeringMap();
+
             /**
              * @brief Checks if the PiCar-X is connected.
              * @return True if the PiCar-X is connected, false otherwise.
             */
             bool isConnected();
 
+            /**
+             * @brief Forgets the shadow copy of the MCU registers and GPIO lines so the next
+             *        writes are sent unconditionally.
+            */
+            void invalidateCache();
+
+            /**
+             * @brief Gets the shadow cache write counters.
+             * @return The number of writes sent and skipped since the last reset.
+            */
+            WriteStats getWriteStats();
+
+            /**
+             * @brief Resets the shadow cache write counters.
+            */
+            void resetWriteStats();
+
             /**
              * @brief Disconnects from the PiCar-X.
+             * @param reset If true, reset the MCU. Otherwise stop the motors and leave the MCU running
+             *              and configured for a warm connect.
             */
-            void disconnect();
+            void disconnect(bool reset=true);
 
             ~PiCarX();
 
@@ -2,6 +2,17 @@
 
     #define PID_HPP
 
+    /**
+     * @brief How the integral term is kept from winding up while the output is saturated.
+     */
+    enum AntiWindup {
+
+        ANTI_WINDUP_NONE,               /** Integrate regardless of the saturation.                        */
+        ANTI_WINDUP_CLAMP,              /** Stop integrating while the error pushes further into saturation. */
+        ANTI_WINDUP_BACK_CALCULATION    /** Bleed the integral by the excess output, at the tracking gain.   */
+
+    };
+
     class PIDController {
 
         private:
@@ -12,6 +23,8 @@
             float dt;       /** Time step.          */
             float ierr;     /** Integral error.     */
             float derr;     /** Derivative error.   */
+            float pterm;    /** Last proportional term. */
+            float dterm;    /** Last derivative term.   */
 
         public:
 
@@ -43,6 +56,15 @@
              */
             float pass(float setpoint, float value);
 
+            /**
+             * @brief Gets the terms of the last response.
+             * 
+             * @param p Receives the proportional term.
+             * @param i Receives the integral term.
+             * @param d Receives the derivative term.
+            */
+            void getTerms(float& p, float& i, float& d) const;
+
             /**
              * @brief Resets the state of the PID controller.
             */
@@ -53,4 +75,97 @@
 
     };
 
+    /**
+     * @brief A PID controller for loops with a jittery period.
+     *
+     * The elapsed time is given to every pass and bounded to [0, dt_max], so a long cycle neither
+     * spikes the derivative nor dumps a large step into the integral. The derivative acts on the
+     * measurement (a setpoint change does not kick the output) through a first-order low-pass of
+     * time constant tau. The output is saturated to [out_min, out_max] and the integral is
+     * protected from windup while it is saturated.
+     */
+    class RobustPIDController {
+
+        private:
+
+            float kp;               /** Proportional gain.                              */
+            float ki;               /** Integral gain.                                  */
+            float kd;               /** Derivative gain.                                */
+            float tau;              /** Time constant of the derivative filter.         */
+            float out_min;          /** Output saturation.                              */
+            float out_max;
+            float dt_max;           /** Longest time step accounted for.                */
+            AntiWindup anti_windup; /** Anti-windup strategy.                           */
+            float kb;               /** Back-calculation tracking gain (1/s).           */
+            bool kb_default;        /** Whether kb follows the gains (kb = 0 given).    */
+
+            float iterm;            /** Integral term.                                  */
+            float dterm;            /** Filtered derivative term.                       */
+            float pterm;            /** Last proportional term.                         */
+            float previous;         /** Previous measurement.                           */
+            bool started;           /** Whether previous holds a measurement.           */
+            bool saturated;         /** Whether the last output was saturated.          */
+
+        public:
+
+            /**
+             * @brief Construct a new RobustPIDController object.
+             * 
+             * @param kp The proportional gain.
+             * @param ki The integral gain.
+             * @param kd The derivative gain.
+             * @param out_min The smallest output.
+             * @param out_max The largest output.
+             * @param dt_max The longest time step accounted for, longer steps are shortened to it.
+             * @param tau The time constant of the derivative low-pass in seconds (0 disables it).
+             * @param anti_windup The anti-windup strategy.
+             * @param kb The back-calculation tracking gain in 1/s (0 picks 10 ki / kp, 1 / dt_max without kp,
+             *           and no tracking without ki).
+            */
+            RobustPIDController(float kp, float ki, float kd, float out_min, float out_max, float dt_max,
+                                float tau=0.0f, AntiWindup anti_windup=ANTI_WINDUP_CLAMP, float kb=0.0f);
+
+            /**
+             * @brief Updates the PID controller using the setpoint, the current input value and the elapsed time.
+             * 
+             * @param setpoint The desired value.
+             * @param value The current value.
+             * @param dt The time elapsed since the previous pass in seconds (the first pass only uses it for the integral).
+             * @return The saturated output of the PID controller.
+             */
+            float pass(float setpoint, float value, float dt);
+
+            /**
+             * @brief Gets the terms of the last response.
+             * 
+             * @param p Receives the proportional term.
+             * @param i Receives the integral term.
+             * @param d Receives the derivative term.
+            */
+            void getTerms(float& p, float& i, float& d) const;
+
+            /**
+             * @brief Checks whether the last output was saturated.
+             * @return True if the last output was saturated, false otherwise.
+            */
+            bool isSaturated() const;
+
+            /**
+             * @brief Changes the gains without a bump in the output: the integral term keeps its
+             *        value (it accumulates ki * err * dt) and the derivative filter keeps its state.
+             *        A default tracking gain follows the new gains.
+             * 
+             * @param kp The proportional gain.
+             * @param ki The integral gain.
+             * @param kd The derivative gain.
+            */
+            void setGains(float kp, float ki, float kd);
+
+            /**
+             * @brief Resets the state of the PID controller.
+            */
+            void reset();
+
+    };
+
 #endif // PID_HPP
@@ -0,0 +1,213 @@
+#ifndef PIPELINE_HPP
+
+    #define PIPELINE_HPP
+
+    #include <stdint.h>
+
+    #include "picarx.hpp"
+    #include "logtable.hpp"
+
+    /**
+     * @brief The control path from raw line sensor codes to a steering pulse width, templated on
+     *        the number format.
+     *
+     * One pass is the same chain as the control step: log difference (table lookup), single-pole
+     * filter (FIRFilter), PID against a 0 setpoint (PIDController), saturation and the servo map
+     * of setSteeringAngle, ending with the pulse width in PWM ticks. Instantiated with float it
+     * follows the float code, instantiated with a Fixed format (e.g. Q16_16) it runs on integers
+     * only and is bit-for-bit reproducible on any core, FPU or not.
+     *
+     * The format needs an integer part large enough for the angles (30) and gains: the pure
+     * fractions Q15 and Q31 cannot hold them. The PID folds ki * dt and kd / dt into its gains, so
+     * no division is left in pass().
+     */
+    template <typename T>
+    class ControlPipeline {
+
+        private:
+
+            T table[LOG_TABLE_SIZE];    /** log(raw * scale + bias) indexed by raw code.   */
+
+            T alpha;                    /** Filter coefficient.                             */
+            T beta;                     /** 1 - alpha.                                      */
+            T kp;                       /** Proportional gain.                              */
+            T ki_dt;                    /** Integral gain times the time step.              */
+            T kd_dt;                    /** Derivative gain divided by the time step.       */
+
+            T min_angle;                /** Steering saturation.                            */
+            T max_angle;
+            T ticks_at_zero;            /** Servo map, in PWM ticks.                        */
+            T ticks_per_degree;
+
+            T xp;                       /** Filter output.                                  */
+            T ierr;                     /** Integral term.                                  */
+            T derr;                     /** Previous error.                                 */
+            T pterm;                    /** Last proportional term.                         */
+            T dterm;                    /** Last derivative term.                           */
+
+        public:
+
+            /**
+             * @brief Construct a new ControlPipeline object.
+             * @param logs The log table of the line sensors (its entries are converted to T).
+             * @param alpha The filter coefficient.
+             * @param kp The proportional gain.
+             * @param ki The integral gain.
+             * @param kd The derivative gain.
+             * @param dt The time step in seconds.
+             * @param map The map from steering angles to servo pulse widths.
+             */
+            ControlPipeline(const LogTable& logs, float alpha, float kp, float ki, float kd, float dt, const SteeringMap& map) {
+
+                this->min_angle = T(map.min_angle);
+                this->max_angle = T(map.max_angle);
+                this->ticks_at_zero = T(map.ticks_at_zero);
+                this->ticks_per_degree = T(map.ticks_per_degree);
+
+                this->configure(logs, alpha, kp, ki, kd, dt);
+                this->reset(T(0.0));
+
+            }
+
+            /**
+             * @brief Replaces the log table and the parameters, the filter and PID states are kept
+             *        (converts the whole table, not for every cycle).
+             * @param logs The log table of the line sensors (its entries are converted to T).
+             * @param alpha The filter coefficient.
+             * @param kp The proportional gain.
+             * @param ki The integral gain.
+             * @param kd The derivative gain.
+             * @param dt The time step in seconds.
+             */
+            void configure(const LogTable& logs, float alpha, float kp, float ki, float kd, float dt) {
+
+                for (int raw = 0; raw < LOG_TABLE_SIZE; raw++) {
+                    this->table[raw] = T(logs.log(raw));
+                }
+
+                this->alpha = T(alpha);
+                this->beta = T(1.0f - alpha);
+                this->kp = T(kp);
+                this->ki_dt = T((double) ki * dt);
+                this->kd_dt = T((double) kd / dt);
+
+            }
+
+            /**
+             * @brief Calculates the difference of logarithms of two raw codes.
+             * @param a The left raw code.
+             * @param b The right raw code.
+             * @return The log difference.
+             */
+            T logdiff(uint16_t a, uint16_t b) const {
+
+                return this->table[(a < LOG_TABLE_SIZE) ? a : LOG_TABLE_SIZE - 1] - this->table[(b < LOG_TABLE_SIZE) ? b : LOG_TABLE_SIZE - 1];
+
+            }
+
+            /**
+             * @brief Updates the filter.
+             * @param x The new input value.
+             * @return The filter output.
+             */
+            T filter(T x) {
+
+                this->xp = this->alpha * x + this->beta * this->xp;
+
+                return this->xp;
+
+            }
+
+            /**
+             * @brief Updates the PID controller against a 0 setpoint.
+             * @param value The current value.
+             * @return The response (steering angle, not saturated).
+             */
+            T pid(T value) {
+
+                T err = -value;
+
+                this->ierr += this->ki_dt * err;
+                this->pterm = this->kp * err;
+                this->dterm = this->kd_dt * (err - this->derr);
+                this->derr = err;
+
+                return this->pterm + this->ierr + this->dterm;
+
+            }
+
+            /**
+             * @brief Saturates an angle to the steering range.
+             * @param angle The steering angle.
+             * @return The angle within the steering range.
+             */
+            T saturate(T angle) const {
+
+                return (angle < this->min_angle) ? this->min_angle : (angle > this->max_angle) ? this->max_angle : angle;
+
+            }
+
+            /**
+             * @brief Saturates an angle and maps it to the servo pulse width.
+             * @param angle The steering angle.
+             * @return The pulse width in PWM ticks (truncated, like setSteeringAngle).
+             */
+            uint16_t pulseWidth(T angle) const {
+
+                angle = this->saturate(angle);
+
+                return (uint16_t) (int) (this->ticks_at_zero + angle * this->ticks_per_degree);
+
+            }
+
+            /**
+             * @brief Runs one control cycle.
+             * @param a The left raw code.
+             * @param b The right raw code.
+             * @param angle Receives the response if not NULL.
+             * @return The steering pulse width in PWM ticks.
+             */
+            uint16_t pass(uint16_t a, uint16_t b, T* angle=NULL) {
+
+                T response = this->pid(this->filter(this->logdiff(a, b)));
+
+                if (angle != NULL) {
+                    *angle = response;
+                }
+
+                return this->pulseWidth(response);
+
+            }
+
+            /**
+             * @brief Gets the terms of the last response.
+             * @param p Receives the proportional term.
+             * @param i Receives the integral term.
+             * @param d Receives the derivative term.
+             */
+            void getTerms(T& p, T& i, T& d) const {
+
+                p = this->pterm;
+                i = this->ierr;
+                d = this->dterm;
+
+            }
+
+            /**
+             * @brief Resets the filter to x0 and clears the PID state.
+             * @param x0 The initial filter output.
+             */
+            void reset(T x0) {
+
+                this->xp = x0;
+                this->ierr = T(0.0);
+                this->derr = T(0.0);
+                this->pterm = T(0.0);
+                this->dterm = T(0.0);
+
+            }
+
+    };
+
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,218 @@
+#ifndef RINGBUFFER_HPP
+
+    #define RINGBUFFER_HPP
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <string.h>
+    #include <atomic>
+    #include <type_traits>
+
+    // ThreadSanitizer does not model fences, its builds order every slot access instead (same guarantees)
+    #if defined(__SANITIZE_THREAD__)
+        #define RINGBUFFER_SLOT_STORE std::memory_order_release
+        #define RINGBUFFER_SLOT_LOAD  std::memory_order_acquire
+    #else
+        #define RINGBUFFER_SLOT_STORE std::memory_order_relaxed
+        #define RINGBUFFER_SLOT_LOAD  std::memory_order_relaxed
+        #define RINGBUFFER_FENCES
+    #endif
+
+    /**
+     * @brief A lock-free ring of the most recent elements, written by one thread and read by any
+     *        number of threads.
+     *
+     * Unlike SPSCQueue the writer never fails nor waits: once the ring is full every push
+     * overwrites the oldest element. head counts the elements written and tail is the oldest
+     * element whose slot is not being overwritten; the writer moves tail before it touches a slot,
+     * so a reader that copies slots and then reads tail knows which of its copies may be torn and
+     * drops them. The elements are stored as relaxed atomic words, so concurrent copies are well
+     * defined, and indices are masked with N - 1 instead of a modulo.
+     *
+     * @tparam T The element type (trivially copyable).
+     * @tparam N The capacity of the ring (a power of two).
+     */
+    template <typename T, size_t N>
+    class RingBuffer {
+
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+        static_assert(std::is_trivially_copyable<T>::value, "RingBuffer requires a trivially copyable type");
+
+        private:
+
+            static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+            alignas(64) std::atomic<uint64_t> head;             /** Number of elements written, owned by the writer. */
+            alignas(64) std::atomic<uint64_t> tail;             /** Oldest element not being overwritten.            */
+            alignas(64) std::atomic<uint64_t> slots[N][WORDS];  /** The elements, split in 64-bit words.             */
+
+        public:
+
+            RingBuffer() : head(0), tail(0) {
+
+                for (size_t i = 0; i < N; i++) {
+
+                    for (size_t j = 0; j < WORDS; j++) {
+                        this->slots[i][j].store(0, std::memory_order_relaxed);
+                    }
+
+                }
+
+            }
+
+            // Prevent copy and assignment
+            RingBuffer(const RingBuffer&) = delete;
+            RingBuffer& operator=(const RingBuffer&) = delete;
+
+            /**
+             * @brief Appends an element, overwriting the oldest one once the ring is full (single writer).
+             * @param value The element to append.
+             */
+            void push(const T& value) {
+
+                uint64_t buffer[WORDS] = {};
+                memcpy(buffer, &value, sizeof(T));
+
+                uint64_t h = this->head.load(std::memory_order_relaxed);
+
+                // Retire the element about to be overwritten before touching its slot
+                if (h >= N) {
+
+                    this->tail.store(h - N + 1, std::memory_order_relaxed);
+
+                    #ifdef RINGBUFFER_FENCES
+                        std::atomic_thread_fence(std::memory_order_release);
+                    #endif
+
+                }
+
+                std::atomic<uint64_t>* slot = this->slots[h & (N - 1)];
+
+                for (size_t j = 0; j < WORDS; j++) {
+                    slot[j].store(buffer[j], RINGBUFFER_SLOT_STORE);
+                }
+
+                this->head.store(h + 1, std::memory_order_release);
+
+            }
+
+            /**
+             * @brief Copies the elements following a cursor, oldest first (any thread).
+             *
+             * Elements overwritten before or during the copy are skipped: the cursor always moves
+             * past every element it covered, so the cursor advance minus the return value is the
+             * number of elements lost.
+             *
+             * @param cursor The index of the first element wanted, advanced past the elements covered.
+             * @param out Receives the elements.
+             * @param count The largest number of elements to copy.
+             * @return The number of elements copied.
+             */
+            size_t copy(uint64_t& cursor, T out[], size_t count) const {
+
+                uint64_t h = this->head.load(std::memory_order_acquire);
+                uint64_t first = (cursor > h) ? h : cursor;
+
+                if (h - first > N) {
+                    first = h - N;
+                }
+
+                size_t n = (h - first < count) ? (size_t) (h - first) : count;
+
+                for (size_t i = 0; i < n; i++) {
+
+                    uint64_t buffer[WORDS];
+                    const std::atomic<uint64_t>* slot = this->slots[(first + i) & (N - 1)];
+
+                    for (size_t j = 0; j < WORDS; j++) {
+                        buffer[j] = slot[j].load(RINGBUFFER_SLOT_LOAD);
+                    }
+
+                    memcpy(&out[i], buffer, sizeof(T));
+
+                }
+
+                #ifdef RINGBUFFER_FENCES
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                #endif
+
+                // Every element older than tail may have been overwritten while it was copied
+                uint64_t t = this->tail.load(std::memory_order_relaxed);
+                size_t lost = (t > first) ? ((t - first < n) ? (size_t) (t - first) : n) : 0;
+
+                if (lost > 0) {
+                    memmove(out, out + lost, (n - lost) * sizeof(T));
+                }
+
+                cursor = first + n;
+
+                return n - lost;
+
+            }
+
+            /**
+             * @brief Copies the most recent elements, oldest first (any thread).
+             * @param out Receives the elements.
+             * @param count The number of elements wanted (at most N).
+             * @return The number of elements copied, less than count if fewer are available or
+             *         some were overwritten during the copy.
+             */
+            size_t snapshot(T out[], size_t count) const {
+
+                uint64_t h = this->head.load(std::memory_order_acquire);
+                uint64_t cursor = (h > count) ? h - count : 0;
+
+                return this->copy(cursor, out, count);
+
+            }
+
+            /**
+             * @brief Copies the newest element (any thread).
+             * @param value Receives the element.
+             * @return False if nothing was written yet.
+             */
+            bool latest(T& value) const {
+
+                uint64_t h;
+
+                // The newest slot can only be lapped if the reader stalls for a full ring
+                do {
+
+                    h = this->head.load(std::memory_order_acquire);
+
+                    if (h == 0) {
+                        return false;
+                    }
+
+                    h--;
+
+                } while (this->copy(h, &value, 1) == 0);
+
+                return true;
+
+            }
+
+            /**
+             * @brief Gets the number of elements written so far, which tells whether a new element is available.
+             * @return The number of elements.
+             */
+            uint64_t count() const {
+
+                return this->head.load(std::memory_order_acquire);
+
+            }
+
+            /**
+             * @brief Gets the capacity of the ring.
+             * @return N.
+             */
+            static constexpr size_t capacity() {
+
+                return N;
+
+            }
+
+    };
+
+
+#endif // RINGBUFFER_HPP
@@ -0,0 +1,106 @@
+#ifndef SAMPLER_HPP
+
+    #define SAMPLER_HPP
+
+    #include <stdint.h>
+    #include <pthread.h>
+    #include <atomic>
+    #include <thread>
+
+    #include "picarx.hpp"
+    #include "ringbuffer.hpp"
+
+    #define SAMPLER_RING_SIZE 64            /** Number of recent frames kept (a power of two).       */
+    #define SAMPLER_BACKOFF_MIN_US 500      /** Sleep after a failed read, doubled while reads fail. */
+    #define SAMPLER_BACKOFF_MAX_US 20000    /** Longest sleep between failed reads.                  */
+
+    /**
+     * @brief Polls the ADC channels on a background thread as fast as the MCU allows.
+     *
+     * Every frame is timestamped and written into a lock-free ring of the most recent frames
+     * (RingBuffer). The writer never waits on readers, so the control loop can read the freshest
+     * frame or a window of recent frames at any rate without taking read latency on its critical
+     * path. Failed reads are retried after a sleep that doubles up to SAMPLER_BACKOFF_MAX_US, so a
+     * missing MCU neither floods the bus nor starves the other threads of the CPU.
+     */
+    class Sampler {
+
+        private:
+
+            PiCarX* picarx;                                         /** The connected PiCar-X.                       */
+            uint8_t mask;                                           /** Channels sampled in every frame.             */
+            int interval_us;                                        /** Minimum time between frames (0 = no limit).  */
+            RingBuffer<SensorFrame, SAMPLER_RING_SIZE> frames;      /** The most recent frames.                      */
+            std::atomic<uint64_t> failed_reads;                     /** Sensor transactions that failed.             */
+            std::atomic<bool> running;                              /** Whether the sampler thread is running.       */
+            std::thread sampler_thread;                             /** The sampler thread.                          */
+
+            /**
+             * @brief The sampler thread body.
+             */
+            void run();
+
+        public:
+
+            /**
+             * @brief Construct a new Sampler object (does nothing, use start() to start sampling).
+             * @param picarx The connected PiCar-X.
+             * @param mask The channels to sample (bitwise or of ADC_MASK_*).
+             * @param interval_us The minimum time between two frames in microseconds (0 = back to back).
+             */
+            Sampler(PiCarX* picarx, uint8_t mask, int interval_us=0);
+
+            // Prevent copy and assignment
+            Sampler(const Sampler&) = delete;
+            Sampler& operator=(const Sampler&) = delete;
+
+            /**
+             * @brief Starts the sampler thread.
+             * @return False if the thread could not be created.
+             */
+            bool start();
+
+            /**
+             * @brief Stops the sampler thread.
+             */
+            void stop();
+
+            /**
+             * @brief Gets the freshest frame.
+             * @param frame Receives the frame.
+             * @return False if no frame was sampled yet.
+             */
+            bool latest(SensorFrame& frame) const;
+
+            /**
+             * @brief Gets the most recent frames, oldest first.
+             * @param frames Receives the frames.
+             * @param count The number of frames wanted (at most SAMPLER_RING_SIZE).
+             * @return The number of frames copied, less than count if fewer are available.
+             */
+            int window(SensorFrame frames[], int count) const;
+
+            /**
+             * @brief Gets the number of frames sampled so far, which tells whether a new frame is available.
+             * @return The number of frames.
+             */
+            uint64_t getCount() const;
+
+            /**
+             * @brief Gets the number of sensor transactions that failed.
+             * @return The number of failed reads.
+             */
+            uint64_t getFailedReads() const;
+
+            /**
+             * @brief Gets the native handle of the sampler thread (e.g. to set its priority or affinity).
+             * @return The pthread handle of the sampler thread.
+             */
+            pthread_t nativeHandle();
+
+            ~Sampler();
+
+    };
+
+
+#endif // SAMPLER_HPP
@@ -0,0 +1,247 @@
+#ifndef SCHEDULER_HPP
+
+    #define SCHEDULER_HPP
+
+    #include <stdint.h>
+    #include <pthread.h>
+    #include <atomic>
+    #include <functional>
+    #include <thread>
+    #include <vector>
+
+    #define SCHEDULER_MAX_SLEEP_NS 100000000ull    /** Longest sleep between two ticks with due tasks, bounds stop(). */
+
+    /**
+     * @brief Period and deadline statistics of a periodic loop.
+     */
+    struct TimingStats {
+
+        uint64_t cycles;            /** Number of completed periods.                         */
+        uint64_t missed;            /** Number of deadlines already passed when waiting.      */
+        double mean_period_ns;      /** Mean measured period between wake-ups.                */
+        double jitter_ns;           /** Standard deviation of the measured period.            */
+        int64_t min_period_ns;      /** Shortest measured period.                             */
+        int64_t max_period_ns;      /** Longest measured period.                              */
+        int64_t max_lateness_ns;    /** Largest delay between a deadline and the wake-up.     */
+
+    };
+
+    /**
+     * @brief A fixed-rate timer sleeping until absolute deadlines on CLOCK_MONOTONIC.
+     *
+     * Unlike a relative sleep after the work, the period does not stretch with the time spent in
+     * the loop body. When a deadline is missed the timer skips the periods that already elapsed
+     * instead of bursting to catch up, so the phase of the loop is preserved.
+     */
+    class PeriodicTimer {
+
+        private:
+
+            uint64_t period_ns;         /** Period in nanoseconds.                    */
+            uint64_t deadline;          /** Next absolute deadline in nanoseconds.    */
+            uint64_t last_wakeup;       /** Time of the previous wake-up.             */
+            uint64_t index;             /** Index of the last deadline waited for.    */
+            uint64_t next_index;        /** Index of the next deadline.               */
+            TimingStats stats;          /** Accumulated statistics.                   */
+            double period_m2;           /** Sum of squared period deviations.         */
+
+        public:
+
+            /**
+             * @brief Construct a new PeriodicTimer object.
+             * @param period_ns The period in nanoseconds.
+             */
+            PeriodicTimer(uint64_t period_ns);
+
+            /**
+             * @brief Starts the timer.
+             * @param origin The monotonic time in nanoseconds of the first deadline, later deadlines are
+             *               aligned to it so timers started with the same origin tick in phase
+             *               (0 puts the first deadline one period from now).
+             */
+            void start(uint64_t origin=0);
+
+            /**
+             * @brief Sleeps until the next deadline and advances it by one period.
+             * @return False if the deadline had already passed (missed), true otherwise.
+             */
+            bool wait();
+
+            /**
+             * @brief Sleeps until the deadline with the given index, skipping the deadlines before it,
+             *        then advances like wait(). The period statistics then measure the time between
+             *        wake-ups, not the period.
+             * @param index The index of the deadline, an earlier one waits for the next deadline.
+             * @return False if the deadline had already passed (missed), true otherwise.
+             */
+            bool waitUntil(uint64_t index);
+
+            /**
+             * @brief Gets the index of the deadline the last wait() returned for, counting the periods
+             *        since the origin, including the skipped ones.
+             * @return The deadline index.
+             */
+            uint64_t getIndex();
+
+            /**
+             * @brief Changes the period, effective from the next deadline.
+             * @param period_ns The period in nanoseconds.
+             */
+            void setPeriod(uint64_t period_ns);
+
+            /**
+             * @brief Gets the period.
+             * @return The period in nanoseconds.
+             */
+            uint64_t getPeriod();
+
+            /**
+             * @brief Gets the accumulated timing statistics.
+             * @return The timing statistics.
+             */
+            TimingStats getStats();
+
+            /**
+             * @brief Resets the accumulated timing statistics.
+             */
+            void resetStats();
+
+    };
+
+    /**
+     * @brief A task run periodically by a TaskScheduler.
+     */
+    struct PeriodicTask {
+
+        const char* name;               /** Name of the task.                                     */
+        uint64_t period;                /** Period in scheduler ticks.                            */
+        uint64_t phase;                 /** Offset of the first run in scheduler ticks.           */
+        int priority;                   /** Order within a tick, lower values run first.          */
+        std::function<void()> run;      /** The task body.                                        */
+        uint64_t runs;                  /** Number of times the task ran.                         */
+        uint64_t max_duration_ns;       /** Longest run of the task.                              */
+
+    };
+
+    /**
+     * @brief Runs tasks with different periods on a single thread.
+     *
+     * Every task runs on the ticks where (tick - phase) is a multiple of its period, in priority
+     * order. Giving slow tasks a phase offset keeps them out of the ticks used by the fast ones,
+     * and schedulers started with the same origin share the same tick boundaries, so phases also
+     * separate tasks running on different threads. The thread only wakes up on the ticks where a
+     * task is due (and at least every SCHEDULER_MAX_SLEEP_NS to notice stop()).
+     */
+    class TaskScheduler {
+
+        private:
+
+            PeriodicTimer timer;                /** The base tick timer.                        */
+            uint64_t tick_ns;                   /** Duration of a tick in nanoseconds.          */
+            uint64_t tick;                      /** Index of the current tick.                  */
+            std::vector<PeriodicTask> tasks;    /** Registered tasks, sorted by priority.       */
+            std::atomic<bool> running;          /** Whether the scheduler loop is running.      */
+            std::thread scheduler_thread;       /** Thread running the loop, if started.        */
+
+            /**
+             * @brief Computes the first tick at or after a given tick where a task is due.
+             * @param task The task.
+             * @param from The tick to start from.
+             * @return The tick index.
+             */
+            static uint64_t nextRun(const PeriodicTask& task, uint64_t from);
+
+        public:
+
+            /**
+             * @brief Construct a new TaskScheduler object.
+             * @param tick_ns The duration of a tick in nanoseconds (a divisor of every task period and phase).
+             */
+            TaskScheduler(uint64_t tick_ns);
+
+            // Prevent copy and assignment
+            TaskScheduler(const TaskScheduler&) = delete;
+            TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+            /**
+             * @brief Registers a task (before the scheduler runs).
+             * @param name The name of the task.
+             * @param period_ns The period of the task in nanoseconds.
+             * @param phase_ns The offset of the task in nanoseconds.
+             * @param priority The order within a tick, lower values run first.
+             * @param run The task body.
+             */
+            void add(const char* name, uint64_t period_ns, uint64_t phase_ns, int priority, std::function<void()> run);
+
+            /**
+             * @brief Runs the scheduler loop on the calling thread until stop() is called.
+             * @param origin The monotonic time in nanoseconds of tick 0 (0 puts it one tick from now).
+             */
+            void run(uint64_t origin=0);
+
+            /**
+             * @brief Runs the scheduler loop on a new thread.
+             * @param origin The monotonic time in nanoseconds of tick 0 (0 puts it one tick from now).
+             * @return False if the thread could not be created.
+             */
+            bool start(uint64_t origin=0);
+
+            /**
+             * @brief Stops the scheduler loop, and joins its thread if it was started with start().
+             */
+            void stop();
+
+            /**
+             * @brief Gets the registered tasks and their run statistics.
+             * @return The tasks.
+             */
+            const std::vector<PeriodicTask>& getTasks();
+
+            /**
+             * @brief Gets the base tick timer (e.g. for its deadline statistics).
+             * @return The timer.
+             */
+            PeriodicTimer& getTimer();
+
+            /**
+             * @brief Gets the native handle of the scheduler thread (e.g. to set its priority or affinity).
+             * @return The pthread handle of the scheduler thread.
+             */
+            pthread_t nativeHandle();
+
+            ~TaskScheduler();
+
+    };
+
+    /**
+     * @brief Switches a thread to the SCHED_FIFO real-time policy.
+     * @param thread The thread to configure.
+     * @param priority The SCHED_FIFO priority in the range [1, 99].
+     * @return True if the policy was applied, false otherwise (usually missing CAP_SYS_NICE).
+     */
+    bool setRealtimePriority(pthread_t thread, int priority);
+
+    /**
+     * @brief Pins a thread to a single CPU.
+     * @param thread The thread to configure.
+     * @param cpu The CPU index.
+     * @return True if the affinity was applied, false otherwise.
+     */
+    bool setCpuAffinity(pthread_t thread, int cpu);
+
+    /**
+     * @brief Checks if the process may lock its memory (root, or an unlimited RLIMIT_MEMLOCK).
+     * @return True if lockMemory() can lock every mapping, false otherwise.
+     */
+    bool canLockMemory();
+
+    /**
+     * @brief Locks the current pages of the process in memory to avoid page faults in the loop.
+     * Call it once every mapping and thread exists: later mappings are not locked, so they never
+     * fail on the RLIMIT_MEMLOCK of the process.
+     * @return True if the memory was locked, false otherwise.
+     */
+    bool lockMemory();
+
+
+#endif // SCHEDULER_HPP
@@ -0,0 +1,129 @@
+#ifndef SEQLOCK_HPP
+
+    #define SEQLOCK_HPP
+
+    #include <stdint.h>
+    #include <string.h>
+    #include <atomic>
+    #include <type_traits>
+
+    /**
+     * @brief A single-writer sequence lock protecting a trivially copyable value.
+     *
+     * The writer never waits. Readers copy the value and retry if the writer was active during the
+     * copy, so they always observe a consistent (non-torn) value. The payload is stored as relaxed
+     * atomic words so concurrent copies are well defined, and the object contains no pointers so it
+     * can live in memory shared between processes.
+     *
+     * @tparam T The protected type.
+     */
+    template <typename T>
+    class SeqLock {
+
+        static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+        private:
+
+            static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+            std::atomic<uint64_t> sequence;         /** Odd while the writer is active.   */
+            std::atomic<uint64_t> words[WORDS];     /** The value, split in 64-bit words. */
+
+        public:
+
+            SeqLock() : sequence(0) {
+
+                for (size_t i = 0; i < WORDS; i++) {
+                    this->words[i].store(0, std::memory_order_relaxed);
+                }
+
+            }
+
+            // Prevent copy and assignment
+            SeqLock(const SeqLock&) = delete;
+            SeqLock& operator=(const SeqLock&) = delete;
+
+            /**
+             * @brief Publishes a new value (single writer).
+             * @param value The value to publish.
+             */
+            void store(const T& value) {
+
+                uint64_t buffer[WORDS] = {};
+                memcpy(buffer, &value, sizeof(T));
+
+                uint64_t seq = this->sequence.load(std::memory_order_relaxed);
+
+                this->sequence.store(seq + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                for (size_t i = 0; i < WORDS; i++) {
+                    this->words[i].store(buffer[i], std::memory_order_relaxed);
+                }
+
+                this->sequence.store(seq + 2, std::memory_order_release);
+
+            }
+
+            /**
+             * @brief Tries to copy the value once.
+             * @param value Receives the value.
+             * @param seq Receives the sequence number of the copied value.
+             * @return False if the writer was active during the copy (value is unusable).
+             */
+            bool tryLoad(T& value, uint64_t& seq) const {
+
+                uint64_t before = this->sequence.load(std::memory_order_acquire);
+
+                if (before & 1) {
+                    return false;
+                }
+
+                uint64_t buffer[WORDS];
+
+                for (size_t i = 0; i < WORDS; i++) {
+                    buffer[i] = this->words[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (this->sequence.load(std::memory_order_relaxed) != before) {
+                    return false;
+                }
+
+                memcpy(&value, buffer, sizeof(T));
+                seq = before;
+
+                return true;
+
+            }
+
+            /**
+             * @brief Copies a consistent value, retrying while the writer is active.
+             * @param value Receives the value.
+             * @return The sequence number of the copied value (0 if nothing was ever published).
+             */
+            uint64_t load(T& value) const {
+
+                uint64_t seq;
+
+                while (!this->tryLoad(value, seq));
+
+                return seq;
+
+            }
+
+            /**
+             * @brief Gets the current sequence number, which changes on every store.
+             * @return The sequence number.
+             */
+            uint64_t getSequence() const {
+
+                return this->sequence.load(std::memory_order_acquire);
+
+            }
+
+    };
+
+
+#endif // SEQLOCK_HPP
@@ -0,0 +1,96 @@
+#ifndef SPSC_HPP
+
+    #define SPSC_HPP
+
+    #include <stddef.h>
+    #include <atomic>
+
+    /**
+     * @brief A lock-free single-producer/single-consumer queue.
+     * @tparam T The element type (trivially copyable).
+     * @tparam N The capacity of the queue (a power of two).
+     */
+    template <typename T, size_t N>
+    class SPSCQueue {
+
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+        private:
+
+            alignas(64) std::atomic<size_t> head;   /** Next slot to write, owned by the producer. */
+            alignas(64) std::atomic<size_t> tail;   /** Next slot to read, owned by the consumer.  */
+            alignas(64) T slots[N];                 /** Queue storage.                             */
+
+        public:
+
+            SPSCQueue() : head(0), tail(0) {}
+
+            // Prevent copy and assignment
+            SPSCQueue(const SPSCQueue&) = delete;
+            SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+            /**
+             * @brief Appends an element (producer side).
+             * @param value The element to append.
+             * @return False if the queue is full and the element was dropped.
+             */
+            bool push(const T& value) {
+
+                size_t h = this->head.load(std::memory_order_relaxed);
+
+                if (h - this->tail.load(std::memory_order_acquire) == N) {
+                    return false;
+                }
+
+                this->slots[h & (N - 1)] = value;
+                this->head.store(h + 1, std::memory_order_release);
+
+                return true;
+
+            }
+
+            /**
+             * @brief Removes the oldest element (consumer side).
+             * @param value Receives the element.
+             * @return False if the queue is empty.
+             */
+            bool pop(T& value) {
+
+                size_t t = this->tail.load(std::memory_order_relaxed);
+
+                if (t == this->head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+
+                value = this->slots[t & (N - 1)];
+                this->tail.store(t + 1, std::memory_order_release);
+
+                return true;
+
+            }
+
+            /**
+             * @brief Drains the queue and keeps only the newest element (consumer side).
+             * @param value Receives the newest element.
+             * @return False if the queue is empty.
+             */
+            bool popLatest(T& value) {
+
+                size_t t = this->tail.load(std::memory_order_relaxed);
+                size_t h = this->head.load(std::memory_order_acquire);
+
+                if (t == h) {
+                    return false;
+                }
+
+                value = this->slots[(h - 1) & (N - 1)];
+                this->tail.store(h, std::memory_order_release);
+
+                return true;
+
+            }
+
+    };
+
+
+#endif // SPSC_HPP
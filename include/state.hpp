@@ -0,0 +1,167 @@
+#ifndef STATE_HPP
+
+    #define STATE_HPP
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <atomic>
+
+    #include "picarx.hpp"
+    #include "seqlock.hpp"
+
+    #define STATE_SHM "/picarx-state"   /** Shared memory segment published by the car.                      */
+    #define STATE_MAGIC 0x54415453      /** "STAT" in little endian.                                         */
+    #define STATE_VERSION 1
+
+    #define STATE_READ_ATTEMPTS 1000    /** Copies tried before the writer is considered dead (about 10 ms). */
+    #define STATE_READ_RETRY_US 10      /** Pause between two copies.                                        */
+
+    /**
+     * @brief What the control loop knows at the end of a cycle, as published to external observers.
+     */
+    struct ControlState {
+
+        uint64_t timestamp;                 /** Monotonic time of the sensor frame in nanoseconds.      */
+        uint64_t published;                 /** Monotonic time of the publication in nanoseconds.       */
+        uint64_t cycle;                     /** Index of the control cycle.                             */
+        uint64_t config_epoch;              /** Epoch of the parameters in use (see ConfigPublisher).   */
+        uint16_t raw[ADC_CHANNELS];         /** Raw ADC codes of A0-A3 and BATT (ADC_IDX_*).            */
+        uint16_t flags;                     /** TELEMETRY_* flags of the cycle.                         */
+        float battery;                      /** Battery voltage in volts.                               */
+        float logdiff;                      /** Log difference of the line sensors.                     */
+        float filtered;                     /** Filtered log difference.                                */
+        float p;                            /** Proportional term of the PID response.                  */
+        float i;                            /** Integral term of the PID response.                      */
+        float d;                            /** Derivative term of the PID response.                    */
+        float angle;                        /** Commanded steering angle.                               */
+        float speed;                        /** Commanded motor speed.                                  */
+        uint32_t step_ns;                   /** Time spent in the control step up to the publication.   */
+        uint64_t cycles;                    /** Control periods completed.                              */
+        uint64_t missed;                    /** Control deadlines missed.                               */
+        int64_t max_lateness_ns;            /** Largest delay between a deadline and the wake-up.       */
+        double mean_period_ns;              /** Mean measured control period.                           */
+        double jitter_ns;                   /** Standard deviation of the measured control period.      */
+
+    };
+
+    /**
+     * @brief The shared memory page: a header, then the state behind a sequence lock.
+     */
+    struct StatePage {
+
+        std::atomic<uint32_t> magic;        /** STATE_MAGIC once the page is initialized.   */
+        uint32_t version;                   /** STATE_VERSION.                              */
+        uint32_t state_size;                /** sizeof(ControlState).                       */
+        uint32_t reserved;                  /** Zero.                                       */
+        SeqLock<ControlState> state;        /** The latest state.                           */
+
+    };
+
+    /**
+     * @brief Publishes the control state in a POSIX shared memory segment.
+     *
+     * The control loop stores the state once per cycle through a sequence lock: it never waits on
+     * observers and observers never write to the page, so any number of processes can map it
+     * read-only and copy consistent snapshots without a system call (see StateReader).
+     */
+    class StatePublisher {
+
+        private:
+
+            char name[256];         /** Name of the shared memory segment.  */
+            StatePage* page;        /** Mapped page.                        */
+
+        public:
+
+            /**
+             * @brief Construct a new StatePublisher object (does nothing, use open() to create the segment).
+             */
+            StatePublisher();
+
+            // Prevent copy and assignment
+            StatePublisher(const StatePublisher&) = delete;
+            StatePublisher& operator=(const StatePublisher&) = delete;
+
+            /**
+             * @brief Creates (or resets) and maps the shared memory segment.
+             * @param name The name of the segment ("/name", see shm_open).
+             * @return True if the segment is ready, false otherwise.
+             */
+            bool open(const char* name);
+
+            /**
+             * @brief Publishes the state (single writer, no system call).
+             * @param state The state.
+             */
+            void publish(const ControlState& state) {
+
+                this->page->state.store(state);
+
+            }
+
+            /**
+             * @brief Checks if the segment is open.
+             * @return True if the segment is open, false otherwise.
+             */
+            bool isOpen() const;
+
+            /**
+             * @brief Unmaps and removes the segment (mapped observers keep the last state).
+             */
+            void close();
+
+            ~StatePublisher();
+
+    };
+
+    /**
+     * @brief Reads the control state published by a StatePublisher of another process.
+     */
+    class StateReader {
+
+        private:
+
+            const StatePage* page;  /** Page mapped read-only. */
+
+        public:
+
+            /**
+             * @brief Construct a new StateReader object (does nothing, use open() to map the segment).
+             */
+            StateReader();
+
+            // Prevent copy and assignment
+            StateReader(const StateReader&) = delete;
+            StateReader& operator=(const StateReader&) = delete;
+
+            /**
+             * @brief Maps the shared memory segment read-only and validates its header.
+             * @param name The name of the segment ("/name", see shm_open).
+             * @return True if the segment is a valid state page, false otherwise.
+             */
+            bool open(const char* name);
+
+            /**
+             * @brief Copies a consistent state (no system call unless the writer is active).
+             *
+             * The segment outlives the car: a car that died in the middle of a publication leaves
+             * the page locked forever, so the copy is retried a bounded number of times.
+             *
+             * @param state Receives the state.
+             * @param seq Receives the sequence number of the state, which changes on every
+             *            publication (0 if nothing was published yet).
+             * @return False if no consistent copy could be made (the writer is stuck or dead).
+             */
+            bool read(ControlState& state, uint64_t& seq) const;
+
+            /**
+             * @brief Unmaps the segment.
+             */
+            void close();
+
+            ~StateReader();
+
+    };
+
+
+#endif // STATE_HPP
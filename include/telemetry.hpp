@@ -0,0 +1,192 @@
+#ifndef TELEMETRY_HPP
+
+    #define TELEMETRY_HPP
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <stdio.h>
+    #include <atomic>
+
+    #define TELEMETRY_MAGIC 0x4D4C4554      /** "TELM" in little endian.                       */
+    #define TELEMETRY_VERSION 1
+    #define TELEMETRY_CHANNELS 5            /** Raw ADC codes per record, indexed by ADC_IDX_*. */
+
+    #define TELEMETRY_ACTUATED (1 << 0)     /** The cycle computed and applied a steering angle. */
+
+    /**
+     * @brief What the car saw and did in one control cycle (64 bytes).
+     */
+    struct TelemetryRecord {
+
+        uint64_t timestamp;                     /** Monotonic time of the sensor frame in nanoseconds. */
+        uint32_t cycle;                         /** Index of the control cycle.                         */
+        uint16_t raw[TELEMETRY_CHANNELS];       /** Raw ADC codes of A0-A3 and BATT.                    */
+        uint16_t flags;                         /** TELEMETRY_* flags.                                  */
+        float logdiff;                          /** Log difference of the line sensors.                 */
+        float filtered;                         /** Filtered log difference.                            */
+        float p;                                /** Proportional term of the PID response.              */
+        float i;                                /** Integral term of the PID response.                  */
+        float d;                                /** Derivative term of the PID response.                */
+        float angle;                            /** Commanded steering angle.                           */
+        float speed;                            /** Commanded motor speed.                              */
+        uint8_t reserved[12];                   /** Padding to 64 bytes, zero.                          */
+
+    };
+
+    static_assert(sizeof(TelemetryRecord) == 64, "TelemetryRecord must stay 64 bytes");
+
+    /**
+     * @brief Prints the CSV header line of the records.
+     * @param file The output file.
+     */
+    void printTelemetryHeader(FILE* file);
+
+    /**
+     * @brief Prints a record as a CSV line.
+     * @param file The output file.
+     * @param record The record.
+     */
+    void printTelemetryRecord(FILE* file, const TelemetryRecord& record);
+
+    /**
+     * @brief Header at the start of a telemetry file (64 bytes), followed by the record ring.
+     */
+    struct TelemetryHeader {
+
+        uint32_t magic;                         /** TELEMETRY_MAGIC.                                    */
+        uint32_t version;                       /** TELEMETRY_VERSION.                                  */
+        uint32_t record_size;                   /** sizeof(TelemetryRecord).                            */
+        uint32_t reserved0;                     /** Zero.                                               */
+        uint64_t capacity;                      /** Number of records in the ring.                      */
+        std::atomic<uint64_t> count;            /** Records written since the file was created.         */
+        uint8_t reserved[32];                   /** Padding to 64 bytes, zero.                          */
+
+    };
+
+    static_assert(sizeof(TelemetryHeader) == 64, "TelemetryHeader must stay 64 bytes");
+
+    /**
+     * @brief Appends telemetry records to a preallocated, memory-mapped ring file.
+     *
+     * The file is sized and mapped (and its pages populated) when it is opened, so append() is a
+     * plain copy into memory with no allocation and no system call. The kernel writes the dirty
+     * pages back in the background, flush() only schedules that write-back. Once the ring is full
+     * the oldest records are overwritten.
+     */
+    class TelemetryRecorder {
+
+        private:
+
+            int fd;                             /** File descriptor of the ring file.  */
+            size_t size;                        /** Size of the mapping in bytes.      */
+            TelemetryHeader* header;            /** Mapped header.                     */
+            TelemetryRecord* records;           /** Mapped record ring.                */
+
+        public:
+
+            /**
+             * @brief Construct a new TelemetryRecorder object (does nothing, use open() to create the file).
+             */
+            TelemetryRecorder();
+
+            // Prevent copy and assignment
+            TelemetryRecorder(const TelemetryRecorder&) = delete;
+            TelemetryRecorder& operator=(const TelemetryRecorder&) = delete;
+
+            /**
+             * @brief Creates (or truncates) and maps the ring file.
+             * @param path The path of the file.
+             * @param capacity The number of records in the ring.
+             * @return True if the file is ready, false otherwise.
+             */
+            bool open(const char* path, uint64_t capacity);
+
+            /**
+             * @brief Appends a record (single writer).
+             * @param record The record.
+             */
+            void append(const TelemetryRecord& record) {
+
+                uint64_t count = this->header->count.load(std::memory_order_relaxed);
+
+                this->records[count % this->header->capacity] = record;
+                this->header->count.store(count + 1, std::memory_order_release);
+
+            }
+
+            /**
+             * @brief Schedules the write-back of the dirty pages without waiting for it (off the hot path).
+             */
+            void flush();
+
+            /**
+             * @brief Checks if the ring file is open.
+             * @return True if the ring file is open, false otherwise.
+             */
+            bool isOpen();
+
+            /**
+             * @brief Writes back and unmaps the ring file.
+             */
+            void close();
+
+            ~TelemetryRecorder();
+
+    };
+
+    /**
+     * @brief Reads the records of a telemetry ring file in chronological order.
+     */
+    class TelemetryReader {
+
+        private:
+
+            int fd;                             /** File descriptor of the ring file.  */
+            size_t size;                        /** Size of the mapping in bytes.      */
+            const TelemetryHeader* header;      /** Mapped header.                     */
+            const TelemetryRecord* records;     /** Mapped record ring.                */
+            uint64_t first;                     /** Index of the oldest record.        */
+            uint64_t available;                 /** Number of records available.       */
+
+        public:
+
+            /**
+             * @brief Construct a new TelemetryReader object (does nothing, use open() to map a file).
+             */
+            TelemetryReader();
+
+            // Prevent copy and assignment
+            TelemetryReader(const TelemetryReader&) = delete;
+            TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+            /**
+             * @brief Maps a ring file read-only and validates its header.
+             * @param path The path of the file.
+             * @return True if the file is a valid telemetry file, false otherwise.
+             */
+            bool open(const char* path);
+
+            /**
+             * @brief Gets the number of records available.
+             * @return The number of records, at most the capacity of the ring.
+             */
+            uint64_t count() const;
+
+            /**
+             * @brief Gets a record.
+             * @param index The index of the record, 0 being the oldest.
+             * @return The record.
+             */
+            const TelemetryRecord& at(uint64_t index) const;
+
+            /**
+             * @brief Unmaps the ring file.
+             */
+            void close();
+
+            ~TelemetryReader();
+
+    };
+
+
+#endif // TELEMETRY_HPP
@@ -0,0 +1,195 @@
+#ifndef TELEMETRY_STREAM_HPP
+
+    #define TELEMETRY_STREAM_HPP
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    #include "telemetry.hpp"
+    #include "ringbuffer.hpp"
+
+    #define TELEMETRY_STREAM_MAGIC 0x534D4C54   /** "TLMS" in little endian.                                  */
+    #define TELEMETRY_STREAM_VERSION 1
+    #define TELEMETRY_STREAM_RING 1024          /** Records kept for slow subscribers (a power of two).       */
+    #define TELEMETRY_STREAM_BATCH 32           /** Largest number of records in a frame.                     */
+    #define TELEMETRY_STREAM_CLIENTS 8          /** Largest number of subscribers, more are refused.          */
+
+    /**
+     * @brief Header of a frame of the telemetry stream (24 bytes), followed by count records.
+     *
+     * Everything is in the byte order of the car (little endian on the Raspberry Pi).
+     */
+    struct TelemetryFrameHeader {
+
+        uint32_t magic;                         /** TELEMETRY_STREAM_MAGIC.                                   */
+        uint16_t version;                       /** TELEMETRY_STREAM_VERSION.                                 */
+        uint16_t count;                         /** Number of records following the header.                  */
+        uint32_t record_size;                   /** sizeof(TelemetryRecord).                                  */
+        uint32_t dropped;                       /** Records dropped for this subscriber since the last frame. */
+        uint64_t sequence;                      /** Index of the first record since the server started.      */
+
+    };
+
+    static_assert(sizeof(TelemetryFrameHeader) == 24, "TelemetryFrameHeader must stay 24 bytes");
+
+    /**
+     * @brief A connection of the telemetry server and the frame it is sending.
+     */
+    struct TelemetrySubscriber {
+
+        int fd;                                 /** Socket, negative for a free entry.                        */
+        uint64_t cursor;                        /** Index of the next record to send.                         */
+        uint64_t dropped;                       /** Records dropped since the last frame.                     */
+        size_t length;                          /** Size of the frame in the buffer.                          */
+        size_t sent;                            /** Bytes of the frame already sent.                          */
+        uint8_t buffer[sizeof(TelemetryFrameHeader) + TELEMETRY_STREAM_BATCH * sizeof(TelemetryRecord)];
+
+    };
+
+    /**
+     * @brief Streams the telemetry records to local subscribers over a UNIX domain socket or TCP
+     *        on the loopback interface.
+     *
+     * The control step only pushes its record into a lock-free ring (publish()). A background
+     * task (service()) accepts subscribers and sends each of them the records it has not seen yet,
+     * in frames of a TelemetryFrameHeader and up to TELEMETRY_STREAM_BATCH records. The sockets are
+     * non-blocking: a subscriber that does not keep up stays where it is while the others go on,
+     * and once it falls a whole ring behind its oldest records are dropped (drop-oldest) and
+     * counted in its next frame. Remote machines can subscribe through an SSH tunnel.
+     */
+    class TelemetryServer {
+
+        private:
+
+            int fd;                                                             /** Listening socket.                      */
+            char path[108];                                                     /** Path of the UNIX socket, "" for TCP.   */
+            RingBuffer<TelemetryRecord, TELEMETRY_STREAM_RING> records;         /** Records published by the control step. */
+            TelemetrySubscriber subscribers[TELEMETRY_STREAM_CLIENTS];          /** Subscribers, fd < 0 when free.         */
+            uint64_t dropped;                                                   /** Records dropped for all subscribers.   */
+
+            /**
+             * @brief Accepts the pending connections.
+             */
+            void accept();
+
+            /**
+             * @brief Sends a subscriber what it has not seen yet, until the socket would block.
+             * @param subscriber The subscriber.
+             * @return False if the connection failed and was closed.
+             */
+            bool send(TelemetrySubscriber& subscriber);
+
+            /**
+             * @brief Closes the connection of a subscriber and frees its entry.
+             * @param subscriber The subscriber.
+             */
+            void drop(TelemetrySubscriber& subscriber);
+
+        public:
+
+            /**
+             * @brief Construct a new TelemetryServer object (does nothing, use open() to listen).
+             */
+            TelemetryServer();
+
+            // Prevent copy and assignment
+            TelemetryServer(const TelemetryServer&) = delete;
+            TelemetryServer& operator=(const TelemetryServer&) = delete;
+
+            /**
+             * @brief Listens for subscribers.
+             * @param address The path of a UNIX socket (replaced if it exists), or "tcp:PORT" to
+             *                listen on the loopback interface.
+             * @return True if the server listens, false otherwise.
+             */
+            bool open(const char* address);
+
+            /**
+             * @brief Publishes a record (single writer, wait-free, no system call).
+             * @param record The record.
+             */
+            void publish(const TelemetryRecord& record) {
+
+                this->records.push(record);
+
+            }
+
+            /**
+             * @brief Accepts the new subscribers and sends the pending records (background task, never blocks).
+             */
+            void service();
+
+            /**
+             * @brief Gets the number of subscribers.
+             * @return The number of connected subscribers.
+             */
+            int getSubscribers() const;
+
+            /**
+             * @brief Gets the number of records dropped because a subscriber did not keep up.
+             * @return The number of records, summed over the subscribers.
+             */
+            uint64_t getDropped() const;
+
+            /**
+             * @brief Checks if the server listens.
+             * @return True if the server listens, false otherwise.
+             */
+            bool isOpen() const;
+
+            /**
+             * @brief Closes the subscribers and stops listening.
+             */
+            void close();
+
+            ~TelemetryServer();
+
+    };
+
+    /**
+     * @brief Receives the frames of a telemetry server (blocking).
+     */
+    class TelemetryClient {
+
+        private:
+
+            int fd;     /** Socket. */
+
+        public:
+
+            /**
+             * @brief Construct a new TelemetryClient object (does nothing, use connect() to subscribe).
+             */
+            TelemetryClient();
+
+            // Prevent copy and assignment
+            TelemetryClient(const TelemetryClient&) = delete;
+            TelemetryClient& operator=(const TelemetryClient&) = delete;
+
+            /**
+             * @brief Subscribes to a server.
+             * @param address The path of a UNIX socket, "tcp:PORT" for the loopback interface or
+             *                "tcp:ADDRESS:PORT" for a numeric IPv4 address.
+             * @return True if connected, false otherwise.
+             */
+            bool connect(const char* address);
+
+            /**
+             * @brief Receives a frame.
+             * @param header Receives the header of the frame.
+             * @param records Receives the records of the frame.
+             * @return False if the connection was closed or the frame is invalid.
+             */
+            bool receive(TelemetryFrameHeader& header, TelemetryRecord records[TELEMETRY_STREAM_BATCH]);
+
+            /**
+             * @brief Closes the connection.
+             */
+            void close();
+
+            ~TelemetryClient();
+
+    };
+
+
+#endif // TELEMETRY_STREAM_HPP
@@ -2,6 +2,8 @@
 
     #define UTILITIES_HPP
 
+    #include <stdint.h>
+
     /**
      * @brief Saturates a value to the range [min, max].
      * @param value The value to saturate.
@@ -32,4 +34,11 @@
     */
     float logdiff(float a, float b, float bias=0.0f);
 
+
+    /**
+     * @brief Reads the monotonic clock.
+     * @return The current CLOCK_MONOTONIC time in nanoseconds.
+    */
+    uint64_t monotonicTime();
+
 #endif // UTILITIES_HPP
@@ -0,0 +1,214 @@
+#include "batch.hpp"
+
+// Lane type and operations of the widest instruction set available, all of them IEEE
+// single precision with one rounding per operation (no FMA, no reciprocal estimates)
+#if defined(__AVX__)
+
+    #include <immintrin.h>
+
+    #define BATCH_ISA "avx"
+    #define BATCH_LANES 8
+
+    typedef __m256 lanes;
+
+    static inline lanes vload(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void vstore(float* p, lanes v) { _mm256_storeu_ps(p, v); }
+    static inline lanes vadd(lanes a, lanes b) { return _mm256_add_ps(a, b); }
+    static inline lanes vsub(lanes a, lanes b) { return _mm256_sub_ps(a, b); }
+    static inline lanes vmul(lanes a, lanes b) { return _mm256_mul_ps(a, b); }
+    static inline lanes vdiv(lanes a, lanes b) { return _mm256_div_ps(a, b); }
+
+#elif defined(__SSE__)
+
+    #include <xmmintrin.h>
+
+    #define BATCH_ISA "sse"
+    #define BATCH_LANES 4
+
+    typedef __m128 lanes;
+
+    static inline lanes vload(const float* p) { return _mm_loadu_ps(p); }
+    static inline void vstore(float* p, lanes v) { _mm_storeu_ps(p, v); }
+    static inline lanes vadd(lanes a, lanes b) { return _mm_add_ps(a, b); }
+    static inline lanes vsub(lanes a, lanes b) { return _mm_sub_ps(a, b); }
+    static inline lanes vmul(lanes a, lanes b) { return _mm_mul_ps(a, b); }
+    static inline lanes vdiv(lanes a, lanes b) { return _mm_div_ps(a, b); }
+
+#elif defined(__aarch64__)
+
+    // 32-bit ARM NEON has no IEEE division and flushes denormals, so it keeps the scalar path
+    #include <arm_neon.h>
+
+    #define BATCH_ISA "neon"
+    #define BATCH_LANES 4
+
+    typedef float32x4_t lanes;
+
+    static inline lanes vload(const float* p) { return vld1q_f32(p); }
+    static inline void vstore(float* p, lanes v) { vst1q_f32(p, v); }
+    static inline lanes vadd(lanes a, lanes b) { return vaddq_f32(a, b); }
+    static inline lanes vsub(lanes a, lanes b) { return vsubq_f32(a, b); }
+    static inline lanes vmul(lanes a, lanes b) { return vmulq_f32(a, b); }
+    static inline lanes vdiv(lanes a, lanes b) { return vdivq_f32(a, b); }
+
+#else
+
+    #define BATCH_ISA "scalar"
+    #define BATCH_LANES 1
+
+    typedef float lanes;
+
+    static inline lanes vload(const float* p) { return *p; }
+    static inline void vstore(float* p, lanes v) { *p = v; }
+    static inline lanes vadd(lanes a, lanes b) { return a + b; }
+    static inline lanes vsub(lanes a, lanes b) { return a - b; }
+    static inline lanes vmul(lanes a, lanes b) { return a * b; }
+    static inline lanes vdiv(lanes a, lanes b) { return a / b; }
+
+#endif
+
+
+BatchFIRFilter::BatchFIRFilter(size_t count) : alpha(count, 1.0f), beta(count, 0.0f), xp(count, 0.0f) {
+
+    this->count = count;
+
+}
+
+
+void BatchFIRFilter::set(size_t index, float alpha, float x0) {
+
+    this->alpha[index] = alpha;
+    this->beta[index] = 1.0f - alpha;
+    this->xp[index] = x0;
+
+}
+
+
+void BatchFIRFilter::pass(const float x[], float out[]) {
+
+    float* alpha = this->alpha.data();
+    float* beta = this->beta.data();
+    float* xp = this->xp.data();
+
+    size_t i = 0;
+
+    // xp = alpha * x + (1 - alpha) * xp
+    for (; i + BATCH_LANES <= this->count; i += BATCH_LANES) {
+
+        lanes y = vadd(vmul(vload(alpha + i), vload(x + i)), vmul(vload(beta + i), vload(xp + i)));
+
+        vstore(xp + i, y);
+        vstore(out + i, y);
+
+    }
+
+    for (; i < this->count; i++) {
+
+        xp[i] = alpha[i] * x[i] + beta[i] * xp[i];
+        out[i] = xp[i];
+
+    }
+
+}
+
+
+void BatchFIRFilter::reset(float x0) {
+
+    for (size_t i = 0; i < this->count; i++) {
+        this->xp[i] = x0;
+    }
+
+}
+
+
+size_t BatchFIRFilter::size() const {
+
+    return this->count;
+
+}
+
+
+BatchPIDController::BatchPIDController(size_t count) : kp(count, 0.0f), ki(count, 0.0f), kd(count, 0.0f), dt(count, 1.0f), ierr(count, 0.0f), derr(count, 0.0f) {
+
+    this->count = count;
+
+}
+
+
+void BatchPIDController::set(size_t index, float kp, float ki, float kd, float dt) {
+
+    this->kp[index] = kp;
+    this->ki[index] = ki;
+    this->kd[index] = kd;
+    this->dt[index] = dt;
+
+}
+
+
+void BatchPIDController::pass(const float setpoints[], const float values[], float responses[]) {
+
+    float* kp = this->kp.data();
+    float* ki = this->ki.data();
+    float* kd = this->kd.data();
+    float* dt = this->dt.data();
+    float* ierr = this->ierr.data();
+    float* derr = this->derr.data();
+
+    size_t i = 0;
+
+    // Same expression tree as PIDController::pass
+    for (; i + BATCH_LANES <= this->count; i += BATCH_LANES) {
+
+        lanes step = vload(dt + i);
+        lanes err = vsub(vload(setpoints + i), vload(values + i));
+        lanes integral = vadd(vload(ierr + i), vmul(vmul(vload(ki + i), err), step));
+        lanes pterm = vmul(vload(kp + i), err);
+        lanes dterm = vdiv(vmul(vload(kd + i), vsub(err, vload(derr + i))), step);
+
+        vstore(ierr + i, integral);
+        vstore(derr + i, err);
+        vstore(responses + i, vadd(vadd(pterm, integral), dterm));
+
+    }
+
+    for (; i < this->count; i++) {
+
+        float err = setpoints[i] - values[i];
+
+        ierr[i] += ki[i] * err * dt[i];
+
+        float pterm = kp[i] * err;
+        float dterm = kd[i] * (err - derr[i]) / dt[i];
+
+        derr[i] = err;
+        responses[i] = pterm + ierr[i] + dterm;
+
+    }
+
+}
+
+
+void BatchPIDController::reset() {
+
+    for (size_t i = 0; i < this->count; i++) {
+
+        this->ierr[i] = 0.0f;
+        this->derr[i] = 0.0f;
+
+    }
+
+}
+
+
+size_t BatchPIDController::size() const {
+
+    return this->count;
+
+}
+
+
+const char* batchInstructionSet() {
+
+    return BATCH_ISA;
+
+}
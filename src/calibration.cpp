@@ -0,0 +1,297 @@
+#include "calibration.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits>
+
+#define CALIBRATION_HEADER "picarx-calibration"
+
+
+RunningStats::RunningStats(uint64_t window) {
+
+    this->window = window;
+
+    this->reset();
+
+}
+
+
+void RunningStats::add(double x) {
+
+    if (this->window == 0 || this->n < this->window) {
+        this->n++;
+    } else {
+        // Forget the share of the spread the new sample replaces
+        this->m2 -= this->m2 / this->n;
+    }
+
+    double delta = x - this->m;
+
+    this->m += delta / this->n;
+    this->m2 += delta * (x - this->m);
+
+}
+
+
+void RunningStats::set(uint64_t count, double mean, double variance) {
+
+    this->n = (this->window != 0 && count > this->window) ? this->window : count;
+    this->m = mean;
+    this->m2 = (this->n > 1) ? variance * (this->n - 1) : 0.0;
+
+}
+
+
+uint64_t RunningStats::count() const {
+
+    return this->n;
+
+}
+
+
+double RunningStats::mean() const {
+
+    return this->m;
+
+}
+
+
+double RunningStats::variance() const {
+
+    return (this->n > 1) ? this->m2 / (this->n - 1) : 0.0;
+
+}
+
+
+double RunningStats::standardError() const {
+
+    if (this->n < 2) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    return sqrt(this->variance() / this->n);
+
+}
+
+
+void RunningStats::reset() {
+
+    this->n = 0;
+    this->m = 0.0;
+    this->m2 = 0.0;
+
+}
+
+
+Calibration::Calibration(uint8_t mask, uint64_t window) : logdiff(window) {
+
+    this->mask = mask & ADC_MASK_ALL;
+
+    for (int i = 0; i < ADC_CHANNELS; i++) {
+        this->channels[i] = RunningStats(window);
+    }
+
+}
+
+
+void Calibration::add(const uint16_t raw[ADC_CHANNELS], double logdiff) {
+
+    this->logdiff.add(logdiff);
+
+    for (int i = 0; i < ADC_CHANNELS; i++) {
+
+        if (this->mask & (1 << i)) {
+            this->channels[i].add(raw[i]);
+        }
+
+    }
+
+}
+
+
+bool Calibration::converged(double tolerance, uint64_t min_samples) const {
+
+    return this->logdiff.count() >= min_samples && this->logdiff.standardError() <= tolerance;
+
+}
+
+
+bool Calibration::agrees(const RunningStats& fresh, double sigmas) const {
+
+    if (fresh.count() == 0 || this->logdiff.count() == 0) {
+        return false;
+    }
+
+    // A constant sensor (variance 0) has no standard error, only the calibration spread counts then
+    double error = (fresh.count() > 1) ? fresh.standardError() : 0.0;
+    double bound = sigmas * (sqrt(this->logdiff.variance()) + error);
+
+    return fabs(fresh.mean() - this->logdiff.mean()) <= bound;
+
+}
+
+
+uint64_t Calibration::count() const {
+
+    return this->logdiff.count();
+
+}
+
+
+double Calibration::offset() const {
+
+    return this->logdiff.mean();
+
+}
+
+
+CalibrationData Calibration::data(int64_t timestamp, float battery) const {
+
+    CalibrationData data;
+
+    memset(&data, 0, sizeof(data));
+
+    data.timestamp = timestamp;
+    data.battery = battery;
+    data.mask = this->mask;
+    data.samples = this->logdiff.count();
+    data.logdiff_mean = this->logdiff.mean();
+    data.logdiff_variance = this->logdiff.variance();
+
+    for (int i = 0; i < ADC_CHANNELS; i++) {
+
+        if (this->mask & (1 << i)) {
+            data.mean[i] = this->channels[i].mean();
+            data.variance[i] = this->channels[i].variance();
+        }
+
+    }
+
+    return data;
+
+}
+
+
+bool Calibration::restore(const CalibrationData& data) {
+
+    if (data.mask != this->mask) {
+        return false;
+    }
+
+    this->logdiff.set(data.samples, data.logdiff_mean, data.logdiff_variance);
+
+    for (int i = 0; i < ADC_CHANNELS; i++) {
+
+        if (this->mask & (1 << i)) {
+            this->channels[i].set(data.samples, data.mean[i], data.variance[i]);
+        }
+
+    }
+
+    return true;
+
+}
+
+
+bool Calibration::save(const char* path, const CalibrationData& data) {
+
+    char temporary[4096];
+
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int) sizeof(temporary)) {
+        return false;
+    }
+
+    FILE* file = fopen(temporary, "w");
+
+    if (file == NULL) {
+
+        perror("calibration file failed to open");
+        return false;
+
+    }
+
+    fprintf(file, "%s %d\n", CALIBRATION_HEADER, CALIBRATION_VERSION);
+    fprintf(file, "timestamp %lld\n", (long long) data.timestamp);
+    fprintf(file, "battery %.3f\n", data.battery);
+    fprintf(file, "mask %u\n", (unsigned int) data.mask);
+    fprintf(file, "samples %llu\n", (unsigned long long) data.samples);
+    fprintf(file, "logdiff %.17g %.17g\n", data.logdiff_mean, data.logdiff_variance);
+
+    for (int i = 0; i < ADC_CHANNELS; i++) {
+
+        if (data.mask & (1 << i)) {
+            fprintf(file, "channel %d %.17g %.17g\n", i, data.mean[i], data.variance[i]);
+        }
+
+    }
+
+    bool written = fflush(file) == 0 && ferror(file) == 0;
+
+    written &= fclose(file) == 0;
+
+    if (!written || rename(temporary, path) != 0) {
+
+        perror("calibration file failed to write");
+        remove(temporary);
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+bool Calibration::load(const char* path, CalibrationData& data) {
+
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    memset(&data, 0, sizeof(data));
+
+    char header[32];
+    int version = 0;
+    long long timestamp = 0;
+    unsigned int mask = 0;
+    unsigned long long samples = 0;
+
+    bool valid = fscanf(file, "%31s %d", header, &version) == 2
+              && strcmp(header, CALIBRATION_HEADER) == 0 && version == CALIBRATION_VERSION
+              && fscanf(file, " timestamp %lld", &timestamp) == 1
+              && fscanf(file, " battery %f", &data.battery) == 1
+              && fscanf(file, " mask %u", &mask) == 1 && mask != 0 && (mask & ~ADC_MASK_ALL) == 0
+              && fscanf(file, " samples %llu", &samples) == 1 && samples > 0
+              && fscanf(file, " logdiff %lf %lf", &data.logdiff_mean, &data.logdiff_variance) == 2;
+
+    for (int i = 0; i < ADC_CHANNELS && valid; i++) {
+
+        if ((mask & (1 << i)) == 0) {
+            continue;
+        }
+
+        int index = -1;
+
+        valid = fscanf(file, " channel %d %lf %lf", &index, &data.mean[i], &data.variance[i]) == 3 && index == i;
+
+    }
+
+    fclose(file);
+
+    data.timestamp = timestamp;
+    data.mask = (uint8_t) mask;
+    data.samples = samples;
+
+    return valid;
+
+}
+
+
+bool Calibration::isFresh(const CalibrationData& data, int64_t now, float battery, int64_t max_age, float max_battery_delta) {
+
+    return now >= data.timestamp && now - data.timestamp <= max_age && fabsf(battery - data.battery) <= max_battery_delta;
+
+}
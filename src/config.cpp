@@ -0,0 +1,422 @@
+#include "config.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define CONFIG_LINE_SIZE 256
+
+
+bool setConfigValue(ControlParameters& parameters, const char* key, const char* value) {
+
+    char* end = NULL;
+
+    errno = 0;
+
+    double number = strtod(value, &end);
+
+    // The whole value must be a number
+    while (end != NULL && isspace((unsigned char) *end)) {
+        end++;
+    }
+
+    if (end == value || end == NULL || *end != '\0' || errno != 0 || !isfinite(number)) {
+
+        fprintf(stderr, "invalid value for %s: %s\n", key, value);
+        return false;
+
+    }
+
+    if (strcmp(key, "kp") == 0) {
+        parameters.kp = (float) number;
+    } else if (strcmp(key, "ki") == 0) {
+        parameters.ki = (float) number;
+    } else if (strcmp(key, "kd") == 0) {
+        parameters.kd = (float) number;
+    } else if (strcmp(key, "speed") == 0) {
+        parameters.speed = (float) number;
+    } else if (strcmp(key, "filter_alpha") == 0) {
+        parameters.filter_alpha = (float) number;
+    } else if (strcmp(key, "log_diff_bias") == 0) {
+        parameters.log_diff_bias = (float) number;
+    } else if (strcmp(key, "dt_us") == 0 && number >= INT_MIN && number <= INT_MAX && number == (int) number) {
+        parameters.dt_us = (int) number;
+    } else {
+
+        fprintf(stderr, "unknown parameter or invalid value: %s = %s\n", key, value);
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+bool validateConfig(const ControlParameters& parameters) {
+
+    if (parameters.speed < -1.0f || parameters.speed > 1.0f) {
+
+        fprintf(stderr, "speed must be in [-1, 1]\n");
+        return false;
+
+    }
+
+    if (!(parameters.filter_alpha > 0.0f && parameters.filter_alpha <= 1.0f)) {
+
+        fprintf(stderr, "filter_alpha must be in (0, 1]\n");
+        return false;
+
+    }
+
+    // A 0 code must still have a logarithm
+    if (!(parameters.log_diff_bias > 0.0f)) {
+
+        fprintf(stderr, "log_diff_bias must be positive\n");
+        return false;
+
+    }
+
+    // A longer period would be clamped by the PID on every step, silently scaling the I and D terms
+    if (parameters.dt_us <= 0 || parameters.dt_us > CONFIG_MAX_DT_US) {
+
+        fprintf(stderr, "dt_us must be in (0, %d]\n", CONFIG_MAX_DT_US);
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+/**
+ * @brief Reads a configuration file into parameters.
+ * @param path The path of the file.
+ * @param parameters The parameters, updated with the keys of the file.
+ * @return True if the file was read and every line is valid, false otherwise.
+ */
+static bool loadConfigFile(const char* path, ControlParameters& parameters) {
+
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+
+        perror("configuration file failed to open");
+        return false;
+
+    }
+
+    char line[CONFIG_LINE_SIZE];
+    int number = 0;
+    bool valid = true;
+
+    while (valid && fgets(line, sizeof(line), file) != NULL) {
+
+        number++;
+
+        // Strip the comment and the surrounding blanks
+        char* comment = strchr(line, '#');
+
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char* key = line;
+
+        while (isspace((unsigned char) *key)) {
+            key++;
+        }
+
+        if (*key == '\0') {
+            continue;
+        }
+
+        char* equal = strchr(key, '=');
+
+        if (equal == NULL) {
+
+            fprintf(stderr, "%s:%d: expected key = value\n", path, number);
+            valid = false;
+            break;
+
+        }
+
+        char* value = equal + 1;
+        char* key_end = equal;
+
+        while (key_end > key && isspace((unsigned char) key_end[-1])) {
+            key_end--;
+        }
+
+        *key_end = '\0';
+
+        while (isspace((unsigned char) *value)) {
+            value++;
+        }
+
+        valid = setConfigValue(parameters, key, value);
+
+    }
+
+    fclose(file);
+
+    return valid;
+
+}
+
+
+bool loadConfig(int argc, char** argv, const ControlParameters& defaults, ControlParameters& parameters, const char** path) {
+
+    const char* config_path = NULL;
+
+    // Find the file first, the command line overrides it whatever the order of the arguments
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strncmp(argv[i], "--config=", 9) == 0) {
+            config_path = argv[i] + 9;
+        }
+
+    }
+
+    if (path != NULL) {
+        *path = config_path;
+    }
+
+    ControlParameters loaded = defaults;
+
+    if (config_path != NULL && !loadConfigFile(config_path, loaded)) {
+        return false;
+    }
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strncmp(argv[i], "--", 2) != 0) {
+
+            fprintf(stderr, "unexpected argument: %s\n", argv[i]);
+            return false;
+
+        }
+
+        const char* key = argv[i] + 2;
+        const char* equal = strchr(key, '=');
+
+        char name[CONFIG_LINE_SIZE];
+        const char* value;
+
+        if (equal != NULL) {
+
+            snprintf(name, sizeof(name), "%.*s", (int) (equal - key), key);
+            value = equal + 1;
+
+        } else if (i + 1 < argc) {
+
+            snprintf(name, sizeof(name), "%s", key);
+            value = argv[++i];
+
+        } else {
+
+            fprintf(stderr, "missing value for %s\n", argv[i]);
+            return false;
+
+        }
+
+        if (strcmp(name, "config") != 0 && !setConfigValue(loaded, name, value)) {
+            return false;
+        }
+
+    }
+
+    if (!validateConfig(loaded)) {
+        return false;
+    }
+
+    parameters = loaded;
+
+    return true;
+
+}
+
+
+ControlConfig::ControlConfig(const ControlParameters& parameters, double scale) : logs(scale, parameters.log_diff_bias) {
+
+    this->epoch = 0;
+    this->parameters = parameters;
+
+}
+
+
+ConfigPublisher::ConfigPublisher(ControlConfig* initial) : current(NULL), acknowledged(0) {
+
+    this->epoch = 1;
+
+    initial->epoch = this->epoch;
+
+    this->current.store(initial, std::memory_order_release);
+
+}
+
+
+void ConfigPublisher::publish(ControlConfig* config) {
+
+    std::lock_guard<std::mutex> lock(this->publishing);
+
+    config->epoch = ++this->epoch;
+
+    const ControlConfig* previous = this->current.exchange(config, std::memory_order_acq_rel);
+
+    this->retired.push_back(previous);
+
+}
+
+
+size_t ConfigPublisher::reclaim() {
+
+    std::lock_guard<std::mutex> lock(this->publishing);
+
+    uint64_t acknowledged = this->acknowledged.load(std::memory_order_acquire);
+
+    size_t kept = 0;
+
+    for (size_t i = 0; i < this->retired.size(); i++) {
+
+        if (this->retired[i]->epoch < acknowledged) {
+            delete this->retired[i];
+        } else {
+            this->retired[kept++] = this->retired[i];
+        }
+
+    }
+
+    this->retired.resize(kept);
+
+    return kept;
+
+}
+
+
+ConfigPublisher::~ConfigPublisher() {
+
+    for (size_t i = 0; i < this->retired.size(); i++) {
+        delete this->retired[i];
+    }
+
+    delete this->current.load(std::memory_order_acquire);
+
+}
+
+
+ConfigWatcher::ConfigWatcher() {
+
+    this->fd = -1;
+    this->name[0] = '\0';
+
+}
+
+
+bool ConfigWatcher::open(const char* path) {
+
+    this->close();
+
+    // Split the path in a directory and a file name
+    char directory[PATH_MAX];
+    const char* slash = strrchr(path, '/');
+
+    if (slash == NULL) {
+
+        snprintf(directory, sizeof(directory), ".");
+        snprintf(this->name, sizeof(this->name), "%s", path);
+
+    } else {
+
+        snprintf(directory, sizeof(directory), "%.*s", (int) ((slash == path) ? 1 : slash - path), path);
+        snprintf(this->name, sizeof(this->name), "%s", slash + 1);
+
+    }
+
+    this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (this->fd < 0) {
+
+        perror("inotify failed to initialize");
+        return false;
+
+    }
+
+    if (inotify_add_watch(this->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+
+        perror("configuration directory failed to watch");
+        this->close();
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+bool ConfigWatcher::changed() {
+
+    if (this->fd < 0) {
+        return false;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+
+    ssize_t length;
+
+    while ((length = read(this->fd, buffer, sizeof(buffer))) > 0) {
+
+        for (ssize_t offset = 0; offset < length; ) {
+
+            const struct inotify_event* event = (const struct inotify_event*) (buffer + offset);
+
+            if (event->len > 0 && strcmp(event->name, this->name) == 0) {
+                changed = true;
+            }
+
+            offset += sizeof(struct inotify_event) + event->len;
+
+        }
+
+    }
+
+    return changed;
+
+}
+
+
+bool ConfigWatcher::isOpen() const {
+
+    return this->fd >= 0;
+
+}
+
+
+void ConfigWatcher::close() {
+
+    if (this->fd >= 0) {
+
+        ::close(this->fd);
+        this->fd = -1;
+
+    }
+
+}
+
+
+ConfigWatcher::~ConfigWatcher() {
+
+    this->close();
+
+}
@@ -0,0 +1,263 @@
+#include "executor.hpp"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <system_error>
+
+#include "utilities.hpp"
+
+#define IO_POLL_US 100  // Polling period if the eventfd is not available
+
+
+IOExecutor::IOExecutor(PiCarX* picarx, uint8_t mask, int period_us) {
+
+    this->picarx = picarx;
+    this->mask = mask;
+    this->period_us = period_us;
+
+    this->running = false;
+    this->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    this->dropped_commands = 0;
+    this->dropped_samples = 0;
+    this->failed_reads = 0;
+
+    if (this->wakeup < 0) {
+        perror("io eventfd failed, polling for commands");
+    }
+
+}
+
+
+bool IOExecutor::start() {
+
+    if (!this->running) {
+
+        this->running = true;
+
+        try {
+
+            this->io_thread = std::thread(&IOExecutor::run, this);
+
+        } catch (const std::system_error& e) {
+
+            fprintf(stderr, "io thread failed to start: %s\n", e.what());
+            this->running = false;
+            return false;
+
+        }
+
+    }
+
+    return true;
+
+}
+
+
+void IOExecutor::stop() {
+
+    if (this->running) {
+
+        this->running = false;
+        this->notify();
+        this->io_thread.join();
+
+    }
+
+}
+
+
+void IOExecutor::wait(uint64_t deadline) {
+
+    struct pollfd pfd = { this->wakeup, POLLIN, 0 };
+    struct timespec timeout;
+    struct timespec* limit = NULL;
+
+    uint64_t now = monotonicTime();
+
+    if (deadline != 0) {
+
+        uint64_t remaining = (deadline > now) ? deadline - now : 0;
+
+        timeout.tv_sec  = remaining / 1000000000ull;
+        timeout.tv_nsec = remaining % 1000000000ull;
+        limit = &timeout;
+
+    }
+
+    if (this->wakeup < 0) {
+
+        // No eventfd: poll for commands, never longer than the deadline
+        if (limit == NULL || limit->tv_sec > 0 || limit->tv_nsec > IO_POLL_US * 1000) {
+            timeout.tv_sec = 0;
+            timeout.tv_nsec = IO_POLL_US * 1000;
+            limit = &timeout;
+        }
+
+        nanosleep(limit, NULL);
+        return;
+
+    }
+
+    if (ppoll(&pfd, 1, limit, NULL) > 0) {
+
+        // Reset the counter, the commands themselves are in the queue
+        uint64_t count;
+
+        if (read(this->wakeup, &count, sizeof(count)) < 0) {
+            return;
+        }
+
+    }
+
+}
+
+
+void IOExecutor::notify() {
+
+    if (this->wakeup >= 0) {
+
+        uint64_t one = 1;
+
+        if (write(this->wakeup, &one, sizeof(one)) < 0) {
+            return;
+        }
+
+    }
+
+}
+
+
+void IOExecutor::run() {
+
+    uint64_t period_ns = (uint64_t) this->period_us * 1000;
+    uint64_t next_sample = monotonicTime();
+
+    ActuatorFrame command;
+    SensorFrame frame;
+
+    while (this->running.load(std::memory_order_acquire)) {
+
+        // Apply the newest command, older ones are stale
+        if (this->commands.popLatest(command)) {
+
+            uint64_t start = monotonicTime();
+            this->picarx->applyActuatorFrame(command);
+            this->write_latency.record(monotonicTime() - start);
+
+        }
+
+        // Actuation only, the sensors are sampled elsewhere
+        if (this->mask == 0) {
+
+            this->wait(0);
+            continue;
+
+        }
+
+        uint64_t now = monotonicTime();
+
+        if (now < next_sample) {
+
+            // Wait for the next sample or a new command, whichever comes first
+            this->wait(next_sample);
+            continue;
+
+        }
+
+        bool read = this->picarx->readFrame(this->mask, frame);
+
+        this->read_latency.record(monotonicTime() - now);
+
+        if (!read) {
+
+            this->failed_reads++;
+
+        } else if (!this->samples.push(frame)) {
+
+            this->dropped_samples++;
+
+        }
+
+        // Do not try to catch up on missed samples after a long bus stall
+        next_sample += period_ns;
+
+        if (next_sample < now) {
+            next_sample = now + period_ns;
+        }
+
+    }
+
+}
+
+
+bool IOExecutor::submit(const ActuatorFrame& frame) {
+
+    if (!this->commands.push(frame)) {
+
+        this->dropped_commands++;
+        return false;
+
+    }
+
+    this->notify();
+
+    return true;
+
+}
+
+
+bool IOExecutor::latest(SensorFrame& frame) {
+
+    return this->samples.popLatest(frame);
+
+}
+
+
+void IOExecutor::getDrops(uint64_t& commands, uint64_t& samples) {
+
+    commands = this->dropped_commands;
+    samples = this->dropped_samples;
+
+}
+
+
+uint64_t IOExecutor::getFailedReads() {
+
+    return this->failed_reads;
+
+}
+
+
+const LatencyHistogram& IOExecutor::getReadLatency() {
+
+    return this->read_latency;
+
+}
+
+
+const LatencyHistogram& IOExecutor::getWriteLatency() {
+
+    return this->write_latency;
+
+}
+
+
+pthread_t IOExecutor::nativeHandle() {
+
+    return this->io_thread.native_handle();
+
+}
+
+
+IOExecutor::~IOExecutor() {
+
+    this->stop();
+
+    if (this->wakeup >= 0) {
+        close(this->wakeup);
+    }
+
+}
@@ -0,0 +1,180 @@
+#include "gpio.hpp"
+
+#include <stdio.h>
+
+GPIOLines::GPIOLines() {
+
+    gpiod_line_bulk_init(&this->bulk);
+
+    this->invalidate();
+
+}
+
+
+bool GPIOLines::request(struct gpiod_chip* chip, const unsigned int offsets[], const int defaults[], unsigned int count, const char* consumer) {
+
+    this->release();
+
+    if (chip == NULL || count == 0 || count > GPIO_MAX_LINES) {
+
+        return false;
+
+    }
+
+    // gpiod_chip_get_lines takes non-const offsets
+    unsigned int lines[GPIO_MAX_LINES];
+
+    for (unsigned int i = 0; i < count; i++) {
+        lines[i] = offsets[i];
+    }
+
+    struct gpiod_line_bulk bulk;
+
+    if (gpiod_chip_get_lines(chip, lines, count, &bulk) < 0) {
+
+        perror("gpio lines failed to open");
+        return false;
+
+    }
+
+    if (gpiod_line_request_bulk_output(&bulk, consumer, defaults) < 0) {
+
+        perror("gpio lines failed to set as output");
+        return false;
+
+    }
+
+    this->bulk = bulk;
+
+    for (unsigned int i = 0; i < count; i++) {
+        this->values[i] = defaults[i];
+    }
+
+    this->known = true;
+
+    return true;
+
+}
+
+
+int GPIOLines::set(const int values[]) {
+
+    unsigned int count = this->size();
+
+    if (count == 0) {
+
+        return -1;
+
+    }
+
+    bool changed = !this->known;
+
+    for (unsigned int i = 0; i < count && !changed; i++) {
+        changed = this->values[i] != values[i];
+    }
+
+    if (!changed) {
+
+        return 0;
+
+    }
+
+    if (gpiod_line_set_value_bulk(&this->bulk, values) < 0) {
+
+        this->known = false;
+        return -1;
+
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        this->values[i] = values[i];
+    }
+
+    this->known = true;
+
+    return 1;
+
+}
+
+
+int GPIOLines::set(unsigned int index, int value) {
+
+    unsigned int count = this->size();
+
+    if (index >= count || !this->known) {
+
+        // Without a trusted shadow copy the other lines cannot be written unchanged
+        return -1;
+
+    }
+
+    int values[GPIO_MAX_LINES];
+
+    for (unsigned int i = 0; i < count; i++) {
+        values[i] = this->values[i];
+    }
+
+    values[index] = value;
+
+    return this->set(values);
+
+}
+
+
+int GPIOLines::get(unsigned int index) const {
+
+    if (index >= this->size() || !this->known) {
+
+        return -1;
+
+    }
+
+    return this->values[index];
+
+}
+
+
+void GPIOLines::invalidate() {
+
+    for (unsigned int i = 0; i < GPIO_MAX_LINES; i++) {
+        this->values[i] = -1;
+    }
+
+    this->known = false;
+
+}
+
+
+unsigned int GPIOLines::size() const {
+
+    return this->bulk.num_lines;
+
+}
+
+
+bool GPIOLines::isRequested() const {
+
+    return this->size() > 0;
+
+}
+
+
+void GPIOLines::release() {
+
+    if (this->isRequested()) {
+
+        gpiod_line_release_bulk(&this->bulk);
+        gpiod_line_bulk_init(&this->bulk);
+
+    }
+
+    this->invalidate();
+
+}
+
+
+GPIOLines::~GPIOLines() {
+
+    this->release();
+
+}
@@ -0,0 +1,123 @@
+#include "histogram.hpp"
+
+
+LatencyHistogram::LatencyHistogram() {
+
+    this->reset();
+
+}
+
+
+uint64_t LatencyHistogram::upperBoundOf(int bucket) {
+
+    if (bucket < HISTOGRAM_SUB_COUNT) {
+        return (uint64_t) bucket;
+    }
+
+    int shift = bucket / HISTOGRAM_SUB_COUNT - 1;
+    uint64_t lower = (uint64_t) (HISTOGRAM_SUB_COUNT + bucket % HISTOGRAM_SUB_COUNT) << shift;
+
+    return lower + ((1ull << shift) - 1);
+
+}
+
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+
+    uint64_t total = this->getCount();
+
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the sample holding the percentile (at least the first sample)
+    uint64_t rank = (uint64_t) (fraction * total + 0.5);
+    rank = (rank < 1) ? 1 : (rank > total) ? total : rank;
+
+    uint64_t seen = 0;
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+
+        seen += this->counts[i].load(std::memory_order_relaxed);
+
+        if (seen >= rank) {
+
+            // Do not report more than the largest sample actually recorded
+            uint64_t bound = upperBoundOf(i);
+            uint64_t largest = this->getMax();
+
+            return (bound > largest) ? largest : bound;
+
+        }
+
+    }
+
+    return this->getMax();
+
+}
+
+
+uint64_t LatencyHistogram::getCount() const {
+
+    return this->count.load(std::memory_order_relaxed);
+
+}
+
+
+double LatencyHistogram::getMean() const {
+
+    uint64_t total = this->getCount();
+
+    return (total == 0) ? 0.0 : (double) this->sum.load(std::memory_order_relaxed) / total;
+
+}
+
+
+uint64_t LatencyHistogram::getMin() const {
+
+    return (this->getCount() == 0) ? 0 : this->min.load(std::memory_order_relaxed);
+
+}
+
+
+uint64_t LatencyHistogram::getMax() const {
+
+    return this->max.load(std::memory_order_relaxed);
+
+}
+
+
+void LatencyHistogram::reset() {
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        this->counts[i].store(0, std::memory_order_relaxed);
+    }
+
+    this->count.store(0, std::memory_order_relaxed);
+    this->sum.store(0, std::memory_order_relaxed);
+    this->min.store(UINT64_MAX, std::memory_order_relaxed);
+    this->max.store(0, std::memory_order_relaxed);
+
+}
+
+
+void LatencyHistogram::dumpHeader(FILE* file) {
+
+    fprintf(file, "# stage count min_ns p50_ns p90_ns p99_ns p999_ns max_ns mean_ns\n");
+
+}
+
+
+void LatencyHistogram::dump(FILE* file, const char* name) const {
+
+    fprintf(file, "%s %llu %llu %llu %llu %llu %llu %llu %.1f\n", name,
+            (unsigned long long) this->getCount(),
+            (unsigned long long) this->getMin(),
+            (unsigned long long) this->percentile(0.50),
+            (unsigned long long) this->percentile(0.90),
+            (unsigned long long) this->percentile(0.99),
+            (unsigned long long) this->percentile(0.999),
+            (unsigned long long) this->getMax(),
+            this->getMean());
+
+}
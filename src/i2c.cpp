@@ -0,0 +1,92 @@
+#include "i2c.hpp"
+#include "i2ctrace.hpp"
+#include "utilities.hpp"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+
+extern "C" {
+#include <linux/i2c-dev.h>
+#include <i2c/smbus.h>
+}
+
+
+int i2cOpen(const char* path) {
+
+    return open(path, O_RDWR);
+
+}
+
+
+int i2cSetAddress(int fd, uint16_t address) {
+
+    return ioctl(fd, I2C_SLAVE, address);
+
+}
+
+
+int i2cTransfer(int fd, struct i2c_msg msgs[], uint32_t count) {
+
+    struct i2c_rdwr_ioctl_data transfer = { msgs, count };
+
+#if I2C_TRACE
+    if (i2c_tracer.isEnabled()) {
+
+        uint64_t start = monotonicTime();
+        int result = ioctl(fd, I2C_RDWR, &transfer);
+        i2c_tracer.recordTransfer(msgs, count, start, monotonicTime(), result);
+
+        return result;
+
+    }
+#endif
+
+    return ioctl(fd, I2C_RDWR, &transfer);
+
+}
+
+
+int i2cWriteWord(int fd, uint8_t reg, uint16_t value) {
+
+#if I2C_TRACE
+    if (i2c_tracer.isEnabled()) {
+
+        uint64_t start = monotonicTime();
+        int result = i2c_smbus_write_word_data(fd, reg, value);
+        i2c_tracer.recordWriteWord(reg, start, monotonicTime(), result);
+
+        return result;
+
+    }
+#endif
+
+    return i2c_smbus_write_word_data(fd, reg, value);
+
+}
+
+
+int i2cReadByte(int fd) {
+
+#if I2C_TRACE
+    if (i2c_tracer.isEnabled()) {
+
+        uint64_t start = monotonicTime();
+        int result = i2c_smbus_read_byte(fd);
+        i2c_tracer.recordReadByte(start, monotonicTime(), result);
+
+        return result;
+
+    }
+#endif
+
+    return i2c_smbus_read_byte(fd);
+
+}
+
+
+void i2cClose(int fd) {
+
+    close(fd);
+
+}
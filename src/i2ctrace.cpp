@@ -0,0 +1,320 @@
+#include "i2ctrace.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+
+I2CTracer i2c_tracer;
+
+
+static const char* const KIND_NAMES[] = { "transfer", "write_word", "read_byte" };
+
+
+I2CTracer::I2CTracer() : enabled(false), head(0), addressed(0) {
+
+    this->reset();
+
+}
+
+
+void I2CTracer::setEnabled(bool enabled) {
+
+    // Nothing calls the tracer in builds without the hooks
+    this->enabled.store(enabled && I2C_TRACE, std::memory_order_relaxed);
+
+}
+
+
+void I2CTracer::account(uint8_t reg, uint16_t bytes, uint64_t share_ns, uint64_t duration_ns, bool failed) {
+
+    this->calls[reg].fetch_add(1, std::memory_order_relaxed);
+    this->bytes[reg].fetch_add(bytes, std::memory_order_relaxed);
+    this->bus_ns[reg].fetch_add(share_ns, std::memory_order_relaxed);
+
+    if (failed) {
+        this->errors[reg].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t max = this->max_ns[reg].load(std::memory_order_relaxed);
+
+    while (duration_ns > max && !this->max_ns[reg].compare_exchange_weak(max, duration_ns, std::memory_order_relaxed));
+
+}
+
+
+void I2CTracer::store(const I2CTransaction& transaction) {
+
+    uint64_t buffer[WORDS] = {};
+    memcpy(buffer, &transaction, sizeof(I2CTransaction));
+
+    uint64_t index = this->head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = this->slots[index & (I2C_TRACE_RING - 1)];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < WORDS; i++) {
+        slot.words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+}
+
+
+bool I2CTracer::read(uint64_t index, I2CTransaction& transaction) const {
+
+    const Slot& slot = this->slots[index & (I2C_TRACE_RING - 1)];
+
+    uint64_t expected = 2 * index + 2;
+
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+
+    uint64_t buffer[WORDS];
+
+    for (size_t i = 0; i < WORDS; i++) {
+        buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+        return false;
+    }
+
+    memcpy(&transaction, buffer, sizeof(I2CTransaction));
+
+    return true;
+
+}
+
+
+void I2CTracer::recordTransfer(const struct i2c_msg msgs[], uint32_t count, uint64_t start, uint64_t end, int result) {
+
+    if (count == 0) {
+        return;
+    }
+
+    uint64_t duration = end - start;
+    uint64_t share = duration / count;
+    bool failed = result < 0;
+
+    I2CTransaction transaction = {};
+
+    transaction.start = start;
+    transaction.duration_ns = (duration > UINT32_MAX) ? UINT32_MAX : (uint32_t) duration;
+    transaction.result = result;
+    transaction.messages = (count > UINT8_MAX) ? UINT8_MAX : (uint8_t) count;
+    transaction.kind = I2C_TRACE_TRANSFER;
+
+    // The MCU takes the register as the first byte of a write, a read returns the register written before it
+    uint8_t reg = this->addressed.load(std::memory_order_relaxed);
+    uint32_t bytes = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        if (msgs[i].flags & I2C_M_RD) {
+
+            transaction.flags |= I2C_TRACE_READ;
+
+        } else if (msgs[i].len > 0) {
+
+            reg = msgs[i].buf[0];
+
+        }
+
+        if (i == 0) {
+            transaction.reg = reg;
+        }
+
+        bytes += msgs[i].len;
+
+        this->account(reg, msgs[i].len, share, duration, failed);
+
+    }
+
+    transaction.bytes = (bytes > UINT16_MAX) ? UINT16_MAX : (uint16_t) bytes;
+
+    this->store(transaction);
+
+}
+
+
+void I2CTracer::recordWriteWord(uint8_t reg, uint64_t start, uint64_t end, int result) {
+
+    uint64_t duration = end - start;
+
+    I2CTransaction transaction = {};
+
+    transaction.start = start;
+    transaction.duration_ns = (duration > UINT32_MAX) ? UINT32_MAX : (uint32_t) duration;
+    transaction.result = result;
+    transaction.bytes = 3;
+    transaction.reg = reg;
+    transaction.messages = 1;
+    transaction.kind = I2C_TRACE_WRITE_WORD;
+
+    this->addressed.store(reg, std::memory_order_relaxed);
+    this->account(reg, transaction.bytes, duration, duration, result < 0);
+    this->store(transaction);
+
+}
+
+
+void I2CTracer::recordReadByte(uint64_t start, uint64_t end, int result) {
+
+    uint64_t duration = end - start;
+
+    I2CTransaction transaction = {};
+
+    transaction.start = start;
+    transaction.duration_ns = (duration > UINT32_MAX) ? UINT32_MAX : (uint32_t) duration;
+    transaction.result = result;
+    transaction.bytes = 1;
+    transaction.reg = this->addressed.load(std::memory_order_relaxed);
+    transaction.messages = 1;
+    transaction.kind = I2C_TRACE_READ_BYTE;
+    transaction.flags = I2C_TRACE_READ;
+
+    this->account(transaction.reg, transaction.bytes, duration, duration, result < 0);
+    this->store(transaction);
+
+}
+
+
+size_t I2CTracer::snapshot(I2CTransaction out[], size_t count) const {
+
+    uint64_t end = this->head.load(std::memory_order_acquire);
+
+    if (count > I2C_TRACE_RING) {
+        count = I2C_TRACE_RING;
+    }
+
+    uint64_t begin = (end > count) ? end - count : 0;
+    size_t copied = 0;
+
+    for (uint64_t i = begin; i < end; i++) {
+
+        if (this->read(i, out[copied])) {
+            copied++;
+        }
+
+    }
+
+    return copied;
+
+}
+
+
+I2CRegisterStats I2CTracer::getRegisterStats(uint8_t reg) const {
+
+    I2CRegisterStats stats;
+
+    stats.calls = this->calls[reg].load(std::memory_order_relaxed);
+    stats.errors = this->errors[reg].load(std::memory_order_relaxed);
+    stats.bytes = this->bytes[reg].load(std::memory_order_relaxed);
+    stats.bus_ns = this->bus_ns[reg].load(std::memory_order_relaxed);
+    stats.max_ns = this->max_ns[reg].load(std::memory_order_relaxed);
+
+    return stats;
+
+}
+
+
+uint64_t I2CTracer::getCount() const {
+
+    return this->head.load(std::memory_order_relaxed);
+
+}
+
+
+void I2CTracer::reset() {
+
+    this->head.store(0, std::memory_order_relaxed);
+    this->addressed.store(0, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < I2C_TRACE_RING; i++) {
+
+        this->slots[i].sequence.store(0, std::memory_order_relaxed);
+
+        for (size_t j = 0; j < WORDS; j++) {
+            this->slots[i].words[j].store(0, std::memory_order_relaxed);
+        }
+
+    }
+
+    for (size_t i = 0; i < I2C_TRACE_REGISTERS; i++) {
+
+        this->calls[i].store(0, std::memory_order_relaxed);
+        this->errors[i].store(0, std::memory_order_relaxed);
+        this->bytes[i].store(0, std::memory_order_relaxed);
+        this->bus_ns[i].store(0, std::memory_order_relaxed);
+        this->max_ns[i].store(0, std::memory_order_relaxed);
+
+    }
+
+}
+
+
+bool I2CTracer::dump(const char* path) const {
+
+    FILE* file = fopen(path, "w");
+
+    if (file == NULL) {
+
+        perror("failed to open the i2c trace file");
+        return false;
+
+    }
+
+    uint64_t transactions = this->getCount();
+    uint64_t total_ns = 0;
+    uint64_t total_errors = 0;
+
+    for (size_t i = 0; i < I2C_TRACE_REGISTERS; i++) {
+        total_ns += this->bus_ns[i].load(std::memory_order_relaxed);
+        total_errors += this->errors[i].load(std::memory_order_relaxed);
+    }
+
+    fprintf(file, "# %llu transactions, %llu failed messages, %.3f ms on the bus\n", (unsigned long long) transactions, (unsigned long long) total_errors, total_ns * 1e-6);
+
+    fprintf(file, "register,calls,errors,bytes,bus_ns,mean_ns,max_ns\n");
+
+    for (size_t i = 0; i < I2C_TRACE_REGISTERS; i++) {
+
+        I2CRegisterStats stats = this->getRegisterStats((uint8_t) i);
+
+        if (stats.calls == 0) {
+            continue;
+        }
+
+        fprintf(file, "0x%02zx,%llu,%llu,%llu,%llu,%.0f,%llu\n", i,
+            (unsigned long long) stats.calls, (unsigned long long) stats.errors, (unsigned long long) stats.bytes,
+            (unsigned long long) stats.bus_ns, (double) stats.bus_ns / stats.calls, (unsigned long long) stats.max_ns);
+
+    }
+
+    I2CTransaction* recent = new I2CTransaction[I2C_TRACE_RING];
+    size_t count = this->snapshot(recent, I2C_TRACE_RING);
+
+    fprintf(file, "\nstart_ns,duration_ns,kind,register,messages,bytes,read,result\n");
+
+    for (size_t i = 0; i < count; i++) {
+
+        const I2CTransaction& t = recent[i];
+
+        fprintf(file, "%llu,%u,%s,0x%02x,%u,%u,%d,%d\n", (unsigned long long) t.start, t.duration_ns,
+            (t.kind <= I2C_TRACE_READ_BYTE) ? KIND_NAMES[t.kind] : "unknown", t.reg, t.messages, t.bytes,
+            (t.flags & I2C_TRACE_READ) ? 1 : 0, t.result);
+
+    }
+
+    delete[] recent;
+
+    fclose(file);
+
+    return true;
+
+}
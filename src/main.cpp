@@ -1,24 +1,241 @@
 #include "picarx.hpp"
 #include "pid.hpp"
 #include "filters.hpp"
+#include "filterbank.hpp"
 #include "utilities.hpp"
 #include "gnuplot.hpp"
+#include "executor.hpp"
+#include "scheduler.hpp"
+#include "histogram.hpp"
+#include "sampler.hpp"
+#include "telemetry.hpp"
+#include "telemetry_stream.hpp"
+#include "state.hpp"
+#include "i2ctrace.hpp"
+#include "logtable.hpp"
+#include "calibration.hpp"
+#include "pipeline.hpp"
+#include "fixed.hpp"
+#include "seqlock.hpp"
+#include "config.hpp"
 
 #include <stdio.h>
 #include <unistd.h>
 #include <math.h>
 #include <signal.h>
+#include <time.h>
+#include <atomic>
 
 
+// Defaults of the parameters read at startup and on reload from --config FILE and --key value arguments
+// (KP is kp, FILTER_ALPHA_COEFF is filter_alpha, ...), see config.hpp
+#define LINE_FILTER 0            // Filter of the log difference: 0 single pole (FILTER_ALPHA_COEFF),
+                                 // 1 2nd order Butterworth (FILTER_CUTOFF_HZ), 2 median of 3 (spike rejection)
 #define FILTER_ALPHA_COEFF 1.0f
-#define LOG_DIFF_BIAS 0.25f
+#define FILTER_CUTOFF_HZ 5.0
+// LOG_DIFF_BIAS and LINE_SENSOR_GAIN are in picarx.hpp, shared with the tools and benchmarks
+
+#define DT_US 10000
 
 #define KP 10.0f
 #define KI 0.0f
 #define KD 0.0f
+#define KD_FILTER_TAU_S 0.02f           // Time constant of the low-pass on the derivative
+#define PID_DT_MAX_S (CONFIG_MAX_DT_US * 1e-6f)  // Longest period accounted for by the PID (the longest dt_us), stalls beyond it are shortened
+#define ANTI_WINDUP ANTI_WINDUP_CLAMP   // Integral protection while the steering is saturated
+
+#define CONTROL_FIXED 0     // 1 runs the log difference, filter and PID of the control step in fixed point
+                            // (ControlPipeline<Q16_16>, integer only): single-pole filter (filter_alpha) and
+                            // plain PID at the configured period, LINE_FILTER, ANTI_WINDUP and KD_FILTER_TAU_S
+                            // do not apply
 
 #define SPEED 0.5f
 
+#define IO_THREAD true      // Run the bus traffic on a dedicated I/O thread
+#define SAMPLER true        // Poll the sensors on a background thread (the I/O thread then only actuates)
+#define SAMPLER_INTERVAL_US 0
+
+#define SENSOR_MASK (ADC_MASK_A0 | ADC_MASK_A3)
+
+#define BACKGROUND_TICK_US 1000     // Tick of the background tasks, phases are multiples of it
+#define PLOT_PERIOD_US 100000       // Periods and phases (offsets from the control step) of the background tasks
+#define PLOT_PHASE_US 5000
+#define BATTERY_PERIOD_US 1000000
+#define BATTERY_PHASE_US 3000
+#define STATS_PERIOD_US 1000000
+#define STATS_PHASE_US 7000
+#define TELEMETRY_PERIOD_US 1000000
+#define TELEMETRY_PHASE_US 9000
+#define CALIBRATION_PERIOD_US 30000000
+#define CALIBRATION_PHASE_US 1000
+#define CONFIG_PERIOD_US 100000     // Checks for a reload request (SIGHUP or a write to the configuration file)
+#define CONFIG_PHASE_US 2000
+#define TELEMETRY_STREAM_PERIOD_US 20000
+#define TELEMETRY_STREAM_PHASE_US 4000
+
+#define WARM_CONNECT true   // Keep the MCU configured across restarts (no reset pulse on connect or exit)
+
+#define LOCK_MEMORY true    // Lock the process memory to avoid page faults in the loop
+
+#define CONTROL_PRIORITY 80 // SCHED_FIFO priorities (0 keeps the default policy)
+#define IO_PRIORITY 85
+#define SAMPLER_PRIORITY 70
+#define BACKGROUND_PRIORITY 0
+
+#define CONTROL_CPU 3       // CPU affinities (-1 lets the kernel choose)
+#define IO_CPU 2
+#define SAMPLER_CPU 1
+#define BACKGROUND_CPU 1
+
+#define LATENCY_FILE "latency.txt" // Latency histograms written on SIGUSR1 and on exit
+#define I2C_TRACE_ENABLED true          // Record the bus transactions (compiled out by make I2C_TRACE=0)
+#define I2C_TRACE_FILE "i2c_trace.txt"  // Per-register bus traffic and the recent transactions, written with the latency
+
+#define TELEMETRY_FILE "telemetry.bin"  // Ring of per-cycle records, read with build/tools/telemetry_dump
+#define TELEMETRY_RECORDS 720000        // 2 hours at 100 Hz (46 MB)
+#define TELEMETRY_STREAM "/tmp/picarx-telemetry.sock"  // Live records for build/tools/telemetry_stream ("tcp:PORT" for TCP on localhost)
+// The latest state is published in the shared memory page STATE_SHM (state.hpp), read with build/tools/state_dump
+
+#define PLOT true           // Plot on the car with gnuplot (x11), false leaves plotting to the telemetry stream subscribers
+
+#define CALIBRATION_FILE "calibration.txt"      // Offsets of the line sensors, reused by the next runs while valid
+#define CALIBRATION_TOLERANCE 0.002             // Startup sampling stops once the mean log difference is known within it
+#define CALIBRATION_MIN_SAMPLES 10
+#define CALIBRATION_MAX_SAMPLES 100
+#define CALIBRATION_MAX_AGE_S 3600              // A saved calibration is reused if it is this recent,
+#define CALIBRATION_MAX_BATTERY_DELTA_V 0.3f    // was measured at a similar battery voltage,
+#define CALIBRATION_CHECK_SAMPLES 5             // and agrees with a few fresh samples
+#define CALIBRATION_CHECK_SIGMAS 3.0
+#define CALIBRATION_WINDOW 6000                 // Refined while driving over about the last minute
+
+#if LINE_FILTER == 1
+    typedef BiquadCascade<float, 1> LineFilter;
+#elif LINE_FILTER == 2
+    typedef Median<float, 3> LineFilter;
+#else
+    typedef FIRFilter LineFilter;
+#endif
+
+#if CONTROL_FIXED
+    typedef ControlPipeline<Q16_16> FixedPipeline;
+#endif
+
+/**
+ * @brief The stages of a control cycle whose latency is measured.
+*/
+enum Stage { STAGE_READ, STAGE_LOGDIFF, STAGE_FILTER, STAGE_PID, STAGE_WRITE, STAGE_PLOT, STAGE_CYCLE, STAGE_COUNT };
+
+const char* STAGE_NAMES[STAGE_COUNT] = { "read", "logdiff", "filter", "pid", "write", "plot", "cycle" };
+
+/**
+ * @brief Creates the filter of the log difference selected by LINE_FILTER.
+ * @param x0 The value the filter starts at (the calibrated mean).
+ * @param dt_s The control period in seconds.
+ * @return The filter.
+*/
+LineFilter* createLineFilter(float x0, float dt_s);
+
+/**
+ * @brief Runs one control cycle: reads the sensors, filters, computes the PID response and actuates.
+ * @return void
+*/
+void controlStep();
+
+/**
+ * @brief Reads the battery voltage (background task).
+ * @return void
+*/
+void batteryStep();
+
+/**
+ * @brief Measures the offsets of the line sensors, or reuses the saved ones if they are still valid.
+ * @param logs The log table of the line sensors.
+ * @param dt_us The sampling period in microseconds.
+ * @return True if the calibration has samples, false if the sensors could not be read.
+*/
+bool calibrate(const LogTable& logs, int dt_us);
+
+/**
+ * @brief Applies the parameters of a new configuration block to the filter, the PID and the
+ *        control period (control thread).
+ * @param config The configuration block.
+ * @return void
+*/
+void applyConfig(const ControlConfig& config);
+
+/**
+ * @brief Reloads the configuration if it was requested (background task).
+ * @return void
+*/
+void configStep();
+
+/**
+ * @brief Requests a reload of the configuration.
+ * This function is called when the process receives SIGHUP, the reload itself
+ * is done by a background task.
+ * @param sig The signal number.
+ * @return void
+*/
+void requestConfigReload(int sig);
+
+/**
+ * @brief Saves the calibration refined by the control step (background task).
+ * @return void
+*/
+void calibrationStep();
+
+/**
+ * @brief Schedules the write-back of the telemetry file (background task).
+ * @return void
+*/
+void telemetryStep();
+
+/**
+ * @brief Sends the new telemetry records to the stream subscribers (background task).
+ * @return void
+*/
+void telemetryStreamStep();
+
+/**
+ * @brief Writes the latency histograms and the I2C trace if a dump was requested (background task).
+ * @return void
+*/
+void statsStep();
+
+/**
+ * @brief Prints the deadline statistics and the task durations of a scheduler.
+ * @param name The name of the scheduler.
+ * @param scheduler The scheduler.
+ * @return void
+*/
+void printSchedulerStats(const char* name, TaskScheduler* scheduler);
+
+/**
+ * @brief Requests a dump of the latency histograms.
+ * This function is called when the process receives SIGUSR1, the dump itself
+ * is done by a background task.
+ * @param sig The signal number.
+ * @return void
+*/
+void requestLatencyDump(int sig);
+
+/**
+ * @brief Writes the latency histograms of every stage to a text file.
+ * @param path The path of the file.
+ * @return void
+*/
+void dumpLatency(const char* path);
+
+/**
+ * @brief Applies the real-time priority and CPU affinity of a thread, warning on failure.
+ * @param thread The thread to configure.
+ * @param name The name of the thread.
+ * @param priority The SCHED_FIFO priority (0 keeps the default policy).
+ * @param cpu The CPU index (-1 lets the kernel choose).
+ * @return void
+*/
+void configureThread(pthread_t thread, const char* name, int priority, int cpu);
+
 /**
  * @brief Gracefully exits the program.
  * This function is called when the user presses Ctrl+C.
@@ -30,24 +247,92 @@ void gracefulExit(int sig);
 
 
 PiCarX* picarx = NULL;
-PIDController* PID = NULL;
-FIRFilter* filter = NULL;
+RobustPIDController* PID = NULL;
+LineFilter* filter = NULL;
+#if LINE_FILTER == 1
+int filter_dt_us = 0;   // Period the Butterworth coefficients are designed for
+#endif
+#if CONTROL_FIXED
+FixedPipeline* pipeline = NULL;
+#endif
 GNUPlot* plot = NULL;
+IOExecutor* io = NULL;
+Sampler* sampler = NULL;
+TaskScheduler* control = NULL;
+TaskScheduler* background = NULL;
+
+// Value of one ADC code of the line sensors, the log tables are built for it
+const double LINE_SENSOR_SCALE = ADC_VREF / ADC_RESO * LINE_SENSOR_GAIN;
+
+const ControlParameters DEFAULT_PARAMETERS = { KP, KI, KD, SPEED, FILTER_ALPHA_COEFF, LOG_DIFF_BIAS, DT_US };
+
+int main_argc = 0;
+char** main_argv = NULL;
+
+ConfigPublisher* configuration = NULL;      // Read by the control step without locking, replaced on reload
+ConfigWatcher config_watcher;
+volatile sig_atomic_t config_reload_requested = 0;
+
+LatencyHistogram latency[STAGE_COUNT];
+volatile sig_atomic_t latency_dump_requested = 0;
+
+TelemetryRecorder telemetry;
+TelemetryServer telemetry_stream;
+StatePublisher state_page;
+
+std::atomic<uint16_t> battery_raw(0);
+
+Calibration calibration(SENSOR_MASK, CALIBRATION_WINDOW);  // Owned by the control step once it runs
+SeqLock<CalibrationData> calibration_snapshot;             // Published by the control step, saved in the background
+
+
+
+int main(int argc, char** argv) {
+
+    // Read the parameters, the command line is read again on every reload
+    main_argc = argc;
+    main_argv = argv;
+
+    ControlParameters parameters;
+    const char* config_path = NULL;
+
+    if (!loadConfig(argc, argv, DEFAULT_PARAMETERS, parameters, &config_path)) {
+
+        printf("Usage: %s [--config FILE] [--kp|--ki|--kd|--speed|--filter_alpha|--log_diff_bias|--dt_us VALUE]...\n", argv[0]);
+        return 1;
 
+    }
+
+    configuration = new ConfigPublisher(new ControlConfig(parameters, LINE_SENSOR_SCALE));
 
+    if (config_path != NULL && !config_watcher.open(config_path)) {
+        fprintf(stderr, "configuration file not watched, reload with SIGHUP\n");
+    }
 
-int main() {
+    const ControlConfig* config = configuration->acquire();
 
-    int dt_us = 10000;
+    int dt_us = parameters.dt_us;
     float dt_s = (float) dt_us * 1e-6;
 
     // Register graceful exit handler
     signal(SIGINT, gracefulExit);
+    signal(SIGUSR1, requestLatencyDump);
+    signal(SIGHUP, requestConfigReload);
+
+    // Checked up front, the memory itself is locked once every mapping and thread exists
+    bool lock_memory = LOCK_MEMORY && canLockMemory();
+
+    if (LOCK_MEMORY && !lock_memory) {
+        fprintf(stderr, "memory will not be locked: RLIMIT_MEMLOCK is limited (run as root or raise ulimit -l)\n");
+    }
+
+    // Trace the bus from the first transaction (connection and calibration included)
+    i2c_tracer.setEnabled(I2C_TRACE_ENABLED);
 
     // Create and connect PiCarX object
     picarx = new PiCarX();
 
-    picarx->connect();
+    picarx->connect(WARM_CONNECT);
 
     if (!picarx->isConnected()) {
     
@@ -56,83 +341,178 @@ int main() {
     
    }
 
-    // Initialize PID controller.
-    PID = new PIDController(KP, KI, KD, dt_s);
+    printf("Connected to PiCarX (%s start)\n", picarx->isWarmStart() ? "warm" : "cold");
 
-    // Initialize FIR filter by calculating the mean of the first 100 samples
-    float mu0 = 0.0f;
+    // Initialize PID controller, saturated like the steering servo
+    SteeringMap steering = PiCarX::steeringMap();
 
-    for (int i = 0; i < 100; i++) {
+    PID = new RobustPIDController(parameters.kp, parameters.ki, parameters.kd, steering.min_angle, steering.max_angle, PID_DT_MAX_S, KD_FILTER_TAU_S, ANTI_WINDUP);
+
+    // Initialize the filter at the offset of the line sensors
+    if (!calibrate(config->logs, dt_us)) {
+
+        printf("Failed to read the line sensors\n");
+        picarx->disconnect(!WARM_CONNECT);
+        return 1;
 
-        float left  = picarx->getAnalogVoltage(A0) * 5.7f;
-        float right = picarx->getAnalogVoltage(A3) * 5.7f;
-        
-        mu0 += logdiff(left, right, LOG_DIFF_BIAS);
-        usleep(dt_us); // TODO check the ability of the MCU to handle this sampling rate
-    
     }
 
-    mu0 /= 100.0f;
+    float mu0 = (float) calibration.offset();
 
-    filter = new FIRFilter(FILTER_ALPHA_COEFF, mu0);
+    filter = createLineFilter(mu0, dt_s);
+
+#if LINE_FILTER == 1
+    filter_dt_us = dt_us;
+#endif
+
+#if CONTROL_FIXED
+    pipeline = new FixedPipeline(config->logs, parameters.filter_alpha, parameters.kp, parameters.ki, parameters.kd, dt_s, steering);
+    pipeline->reset(Q16_16(mu0));
+#endif
+
+    applyConfig(*config);
+
+    // Preallocate and map the telemetry file, the run goes on without it if this fails
+    if (!telemetry.open(TELEMETRY_FILE, TELEMETRY_RECORDS)) {
+        fprintf(stderr, "telemetry disabled\n");
+    }
+
+    if (!telemetry_stream.open(TELEMETRY_STREAM)) {
+        fprintf(stderr, "telemetry stream disabled\n");
+    }
+
+    if (!state_page.open(STATE_SHM)) {
+        fprintf(stderr, "state page disabled\n");
+    }
 
     // Initialize GNUPlot
-    plot = new GNUPlot("Steering Angle", "Log Difference", -5.0, 5.0f, 100, dt_s);
+    if (PLOT) {
+        plot = new GNUPlot("Steering Angle", "Log Difference", -5.0, 5.0f, 100, dt_s, false);
+    }
 
-    // Set speed
-    picarx->setMotorSpeed(SPEED);
+    // The motors start with the first actuator frame of the control step, once every thread runs
+    bool started = true;
 
-    // Control loop
-    while (true) {
+    // Start the sampler thread, from now on it reads the sensors
+    if (SAMPLER) {
 
-        // Get battery voltage
-        float battery_voltage = picarx->getBatteryVoltage();
-	    
-        // Get analog voltage from A0 and A1
-        float left  = picarx->getAnalogVoltage(A0) * 5.7f;
-        float right = picarx->getAnalogVoltage(A3) * 5.7f;
+        sampler = new Sampler(picarx, SENSOR_MASK, SAMPLER_INTERVAL_US);
+        started = sampler->start();
 
-	    // Get log difference between left and right
-        float diff = logdiff(left, right, LOG_DIFF_BIAS);
+        if (started) {
+            configureThread(sampler->nativeHandle(), "sampler", SAMPLER_PRIORITY, SAMPLER_CPU);
+        }
 
-        // Add data to plot
-        plot->add(diff);
+    }
+
+    // Start the I/O thread, from now on it owns the bus
+    if (started && IO_THREAD) {
+
+        io = new IOExecutor(picarx, (sampler != NULL) ? 0 : SENSOR_MASK, dt_us);
+        started = io->start();
+
+        if (started) {
+            configureThread(io->nativeHandle(), "io", IO_PRIORITY, IO_CPU);
+        }
+
+    }
+
+    // Slow tasks run on a background thread, in ticks where the control step does not run
+    background = new TaskScheduler((uint64_t) BACKGROUND_TICK_US * 1000);
+
+    if (plot != NULL) {
+        background->add("plot", (uint64_t) PLOT_PERIOD_US * 1000, (uint64_t) PLOT_PHASE_US * 1000, 0, [] { plot->refresh(); });
+    }
+
+    background->add("battery", (uint64_t) BATTERY_PERIOD_US * 1000, (uint64_t) BATTERY_PHASE_US * 1000, 1, batteryStep);
+    background->add("stats", (uint64_t) STATS_PERIOD_US * 1000, (uint64_t) STATS_PHASE_US * 1000, 2, statsStep);
+    background->add("telemetry", (uint64_t) TELEMETRY_PERIOD_US * 1000, (uint64_t) TELEMETRY_PHASE_US * 1000, 3, telemetryStep);
+    background->add("calibration", (uint64_t) CALIBRATION_PERIOD_US * 1000, (uint64_t) CALIBRATION_PHASE_US * 1000, 4, calibrationStep);
+    background->add("config", (uint64_t) CONFIG_PERIOD_US * 1000, (uint64_t) CONFIG_PHASE_US * 1000, 5, configStep);
+    background->add("stream", (uint64_t) TELEMETRY_STREAM_PERIOD_US * 1000, (uint64_t) TELEMETRY_STREAM_PHASE_US * 1000, 6, telemetryStreamStep);
 
-        // Verify the validity of the difference
-        if (!isnan(diff) && !isinf(diff)) {
-        
-            // Filter the log difference
-            float filtered = filter->pass(diff);
+    // The control step runs at a fixed rate on the main thread
+    control = new TaskScheduler((uint64_t) dt_us * 1000);
 
-            // Get pid response
-            float response = PID->pass(0.0f, filtered);
+    control->add("control", (uint64_t) dt_us * 1000, 0, 0, controlStep);
 
-            // Set steering angle
-            picarx->setSteeringAngle(response);
-        
+    // Both schedulers share the same origin so the phases hold across threads
+    uint64_t origin = monotonicTime() + (uint64_t) dt_us * 1000;
+
+    if (started) {
+        started = background->start(origin);
+    }
+
+    if (started) {
+
+        configureThread(background->nativeHandle(), "background", BACKGROUND_PRIORITY, BACKGROUND_CPU);
+        configureThread(pthread_self(), "control", CONTROL_PRIORITY, CONTROL_CPU);
+
+        // Every mapping and thread stack exists now, the control timer skips the ticks this takes
+        if (lock_memory && !lockMemory()) {
+            perror("failed to lock memory");
         }
 
-        usleep(dt_us);
+        control->run(origin);
+
+    } else {
 
+        printf("Failed to start the threads\n");
+
+    }
+
+    if (background != NULL) {
+        background->stop();
+        delete background;
+        background = NULL;
+    }
+
+    if (sampler != NULL) {
+        sampler->stop();
+        delete sampler;
+        sampler = NULL;
+    }
+
+    if (io != NULL) {
+        io->stop();
+        delete io;
+        io = NULL;
     }
 
     if (picarx != NULL) {
-        picarx->disconnect();
+        picarx->disconnect(!WARM_CONNECT);
         delete picarx;
         picarx = NULL;
     }
 
+    calibrationStep();
+    telemetry.close();
+    telemetry_stream.close();
+    state_page.close();
+
     if (PID != NULL) {
         delete PID;
         PID = NULL;
     }
 
+#if CONTROL_FIXED
+    if (pipeline != NULL) {
+        delete pipeline;
+        pipeline = NULL;
+    }
+#endif
+
+    if (configuration != NULL) {
+        delete configuration;
+        configuration = NULL;
+    }
+
     if (plot != NULL) {
         delete plot;
         plot = NULL;
     }
 
-    return 0;
+    return started ? 0 : 1;
 
 }
 
@@ -141,23 +521,531 @@ void gracefulExit(int sig) {
 
     printf("Gracefully exiting...\n");
 
+    dumpLatency(LATENCY_FILE);
+
+    if (i2c_tracer.isEnabled()) {
+        i2c_tracer.dump(I2C_TRACE_FILE);
+    }
+
+    if (control != NULL) {
+        control->stop();
+        printSchedulerStats("control", control);
+    }
+
+    if (background != NULL) {
+        background->stop();
+        printSchedulerStats("background", background);
+        delete background;
+        background = NULL;
+    }
+
+    if (sampler != NULL) {
+        sampler->stop();
+        delete sampler;
+        sampler = NULL;
+    }
+
+    if (io != NULL) {
+        io->stop();
+        delete io;
+        io = NULL;
+    }
+
+    if (picarx != NULL) {
+        WriteStats stats = picarx->getWriteStats();
+        printf("Register writes: %llu sent, %llu skipped\n", (unsigned long long) stats.register_writes, (unsigned long long) stats.register_skips);
+        printf("GPIO writes: %llu sent, %llu skipped, %llu failed\n", (unsigned long long) stats.gpio_writes, (unsigned long long) stats.gpio_skips, (unsigned long long) stats.gpio_errors);
+    }
+
     if (picarx != NULL) {
-        picarx->disconnect();
+        picarx->disconnect(!WARM_CONNECT);
         delete picarx;
         picarx = NULL;
     }
 
+    calibrationStep();
+    telemetry.close();
+    telemetry_stream.close();
+    state_page.close();
+
     if (PID != NULL) {
         delete PID;
         PID = NULL;
     }
 
+#if CONTROL_FIXED
+    if (pipeline != NULL) {
+        delete pipeline;
+        pipeline = NULL;
+    }
+#endif
+
+    if (configuration != NULL) {
+        delete configuration;
+        configuration = NULL;
+    }
+
     if (plot != NULL) {
         plot->disconnect();
 	delete plot;
         plot = NULL;
     }
 
+    if (control != NULL) {
+        delete control;
+        control = NULL;
+    }
+
     exit(0);
 
 }
+
+
+LineFilter* createLineFilter(float x0, float dt_s) {
+
+#if LINE_FILTER == 1
+    LineFilter* line_filter = new LineFilter(LineFilter::butterworth(FILTER_CUTOFF_HZ, dt_s));
+#elif LINE_FILTER == 2
+    LineFilter* line_filter = new LineFilter();
+    (void) dt_s;
+#else
+    LineFilter* line_filter = new LineFilter(DEFAULT_PARAMETERS.filter_alpha);
+    (void) dt_s;
+#endif
+
+    line_filter->reset(x0);
+
+    return line_filter;
+
+}
+
+
+void configureThread(pthread_t thread, const char* name, int priority, int cpu) {
+
+    if (priority > 0 && !setRealtimePriority(thread, priority)) {
+        fprintf(stderr, "failed to set the real-time priority of the %s thread\n", name);
+    }
+
+    if (cpu >= 0 && !setCpuAffinity(thread, cpu)) {
+        fprintf(stderr, "failed to pin the %s thread to cpu %d\n", name, cpu);
+    }
+
+}
+
+
+void requestLatencyDump(int sig) {
+
+    latency_dump_requested = 1;
+
+}
+
+
+void dumpLatency(const char* path) {
+
+    FILE* file = fopen(path, "w");
+
+    if (file == NULL) {
+
+        perror("failed to open the latency file");
+        return;
+
+    }
+
+    LatencyHistogram::dumpHeader(file);
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        latency[i].dump(file, STAGE_NAMES[i]);
+    }
+
+    if (io != NULL) {
+        io->getReadLatency().dump(file, "io_read");
+        io->getWriteLatency().dump(file, "io_write");
+    }
+
+    fclose(file);
+
+}
+
+
+void controlStep() {
+
+    static SensorFrame frame;
+    static uint64_t last_timestamp = 0;
+#if !CONTROL_FIXED
+    static uint64_t last_pid_timestamp = 0;
+#endif
+
+    uint64_t start = monotonicTime();
+
+    // Take the current parameters, a reload is seen at the start of a cycle
+    static uint64_t applied_epoch = 0;
+
+    const ControlConfig* config = configuration->acquire();
+
+    if (config->epoch != applied_epoch) {
+
+        applyConfig(*config);
+        applied_epoch = config->epoch;
+
+    }
+
+    // Get analog voltage from A0 and A3 in one transaction
+    bool fresh;
+
+    if (sampler != NULL) {
+        fresh = sampler->latest(frame) && frame.timestamp != last_timestamp;
+    } else if (io != NULL) {
+        fresh = io->latest(frame);
+    } else {
+        fresh = picarx->readFrame(SENSOR_MASK, frame);
+    }
+
+    uint64_t read = monotonicTime();
+    latency[STAGE_READ].record(read - start);
+
+    if (!fresh) {
+        return;
+    }
+
+    last_timestamp = frame.timestamp;
+
+    TelemetryRecord record = {};
+
+    record.timestamp = frame.timestamp;
+    record.cycle = (uint32_t) control->getTimer().getIndex();
+    record.raw[ADC_IDX_A0] = frame.raw[ADC_IDX_A0];
+    record.raw[ADC_IDX_A3] = frame.raw[ADC_IDX_A3];
+    record.raw[ADC_IDX_BATT] = battery_raw.load(std::memory_order_relaxed);
+
+    // Get log difference between left and right (table lookup on the raw codes)
+    float diff = config->logs.logdiffRaw(frame.raw[ADC_IDX_A0], frame.raw[ADC_IDX_A3]);
+
+    uint64_t logdiffed = monotonicTime();
+    latency[STAGE_LOGDIFF].record(logdiffed - read);
+
+    record.logdiff = diff;
+
+    // Add data to plot
+    if (plot != NULL) {
+        plot->add(diff);
+    }
+
+    uint64_t plotted = monotonicTime();
+    latency[STAGE_PLOT].record(plotted - logdiffed);
+
+    // Verify the validity of the difference
+    if (!isnan(diff) && !isinf(diff)) {
+
+        // Refine the sensor offsets for the next runs
+        calibration.add(frame.raw, diff);
+        calibration_snapshot.store(calibration.data(0, 0.0f));
+
+        // Filter the log difference
+#if CONTROL_FIXED
+        Q16_16 fixed_filtered = pipeline->filter(pipeline->logdiff(frame.raw[ADC_IDX_A0], frame.raw[ADC_IDX_A3]));
+        float filtered = (float) fixed_filtered;
+#else
+        float filtered = filter->pass(diff);
+#endif
+
+        uint64_t filtered_at = monotonicTime();
+        latency[STAGE_FILTER].record(filtered_at - plotted);
+
+        // Get pid response, over the time actually elapsed between the sensor frames
+#if CONTROL_FIXED
+        float response = (float) pipeline->saturate(pipeline->pid(fixed_filtered));
+#else
+        float elapsed = (last_pid_timestamp != 0) ? (frame.timestamp - last_pid_timestamp) * 1e-9f : control->getTimer().getPeriod() * 1e-9f;
+        float response = PID->pass(0.0f, filtered, elapsed);
+
+        last_pid_timestamp = frame.timestamp;
+#endif
+
+        uint64_t responded = monotonicTime();
+        latency[STAGE_PID].record(responded - filtered_at);
+
+        // Set steering angle and speed
+        ActuatorFrame command = { config->parameters.speed, response };
+
+        if (io != NULL) {
+            io->submit(command);
+        } else {
+            picarx->applyActuatorFrame(command);
+        }
+
+        latency[STAGE_WRITE].record(monotonicTime() - responded);
+
+        record.flags |= TELEMETRY_ACTUATED;
+        record.filtered = filtered;
+        record.angle = command.angle;
+        record.speed = command.speed;
+
+#if CONTROL_FIXED
+        Q16_16 p, i, d;
+        pipeline->getTerms(p, i, d);
+
+        record.p = (float) p;
+        record.i = (float) i;
+        record.d = (float) d;
+#else
+        PID->getTerms(record.p, record.i, record.d);
+#endif
+
+    }
+
+    if (telemetry.isOpen()) {
+        telemetry.append(record);
+    }
+
+    telemetry_stream.publish(record);
+
+    // Publish the state of the loop to the observers of the shared memory page
+    if (state_page.isOpen()) {
+
+        ControlState state = {};
+        TimingStats timing = control->getTimer().getStats();
+
+        state.timestamp = record.timestamp;
+        state.cycle = record.cycle;
+        state.config_epoch = config->epoch;
+        state.flags = record.flags;
+        state.battery = PiCarX::toVoltage(ADC_IDX_BATT, record.raw[ADC_IDX_BATT]);
+        state.logdiff = record.logdiff;
+        state.filtered = record.filtered;
+        state.p = record.p;
+        state.i = record.i;
+        state.d = record.d;
+        state.angle = record.angle;
+        state.speed = record.speed;
+        state.cycles = timing.cycles;
+        state.missed = timing.missed;
+        state.max_lateness_ns = timing.max_lateness_ns;
+        state.mean_period_ns = timing.mean_period_ns;
+        state.jitter_ns = timing.jitter_ns;
+
+        for (int i = 0; i < ADC_CHANNELS; i++) {
+            state.raw[i] = record.raw[i];
+        }
+
+        state.published = monotonicTime();
+        state.step_ns = (uint32_t) (state.published - start);
+
+        state_page.publish(state);
+
+    }
+
+    latency[STAGE_CYCLE].record(monotonicTime() - start);
+
+}
+
+
+void batteryStep() {
+
+    SensorFrame frame;
+
+    if (picarx->readFrame(ADC_MASK_BATT, frame)) {
+        battery_raw.store(frame.raw[ADC_IDX_BATT], std::memory_order_relaxed);
+    }
+
+}
+
+
+bool calibrate(const LogTable& logs, int dt_us) {
+
+    uint16_t raw[ADC_CHANNELS];
+
+    // The battery task does not run yet, read the level the calibration is stamped with
+    if (picarx->readChannelsRaw(ADC_MASK_BATT, raw)) {
+        battery_raw.store(raw[ADC_IDX_BATT], std::memory_order_relaxed);
+    }
+
+    float battery = PiCarX::toVoltage(ADC_IDX_BATT, battery_raw.load(std::memory_order_relaxed));
+
+    // Reuse the saved offsets if they are recent, measured at a similar battery level and agree with fresh samples
+    CalibrationData saved;
+
+    if (Calibration::load(CALIBRATION_FILE, saved) && Calibration::isFresh(saved, time(NULL), battery, CALIBRATION_MAX_AGE_S, CALIBRATION_MAX_BATTERY_DELTA_V)
+        && calibration.restore(saved)) {
+
+        RunningStats fresh;
+
+        for (int i = 0; i < CALIBRATION_CHECK_SAMPLES; i++) {
+
+            if (picarx->readChannelsRaw(SENSOR_MASK, raw)) {
+                fresh.add(logs.logdiffRaw(raw[ADC_IDX_A0], raw[ADC_IDX_A3]));
+            }
+
+            usleep(dt_us);
+
+        }
+
+        if (calibration.agrees(fresh, CALIBRATION_CHECK_SIGMAS)) {
+
+            printf("Reusing the calibration of %s (%llu samples)\n", CALIBRATION_FILE, (unsigned long long) calibration.count());
+            return true;
+
+        }
+
+        calibration = Calibration(SENSOR_MASK, CALIBRATION_WINDOW);
+
+    }
+
+    // Sample until the mean is known within the tolerance
+    for (int i = 0; i < CALIBRATION_MAX_SAMPLES && !calibration.converged(CALIBRATION_TOLERANCE, CALIBRATION_MIN_SAMPLES); i++) {
+
+        if (picarx->readChannelsRaw(SENSOR_MASK, raw)) {
+            calibration.add(raw, logs.logdiffRaw(raw[ADC_IDX_A0], raw[ADC_IDX_A3]));
+        }
+
+        usleep(dt_us); // TODO check the ability of the MCU to handle this sampling rate
+
+    }
+
+    if (calibration.count() == 0) {
+        return false;
+    }
+
+    printf("Calibrated with %llu samples\n", (unsigned long long) calibration.count());
+
+    Calibration::save(CALIBRATION_FILE, calibration.data(time(NULL), battery));
+
+    return true;
+
+}
+
+
+void calibrationStep() {
+
+    CalibrationData data;
+
+    // Nothing to save until the control step published a refined calibration
+    if (calibration_snapshot.load(data) == 0) {
+        return;
+    }
+
+    data.timestamp = time(NULL);
+    data.battery = PiCarX::toVoltage(ADC_IDX_BATT, battery_raw.load(std::memory_order_relaxed));
+
+    Calibration::save(CALIBRATION_FILE, data);
+
+}
+
+
+void applyConfig(const ControlConfig& config) {
+
+    const ControlParameters& parameters = config.parameters;
+
+    PID->setGains(parameters.kp, parameters.ki, parameters.kd);
+
+#if LINE_FILTER == 0
+    filter->alpha = parameters.filter_alpha;
+#endif
+
+#if CONTROL_FIXED
+    // Converts the log table of the block (once per reload)
+    pipeline->configure(config.logs, parameters.filter_alpha, parameters.kp, parameters.ki, parameters.kd, parameters.dt_us * 1e-6f);
+#endif
+
+    // The new period starts at the next deadline (the background tasks then lose their phase to the control step)
+    uint64_t period_ns = (uint64_t) parameters.dt_us * 1000;
+
+    if (control != NULL && control->getTimer().getPeriod() != period_ns) {
+        control->getTimer().setPeriod(period_ns);
+    }
+
+}
+
+
+void configStep() {
+
+    bool requested = config_reload_requested != 0;
+
+    // Drain the watcher every time so an old write does not trigger a late reload
+    requested |= config_watcher.changed();
+
+    configuration->reclaim();
+
+    if (!requested) {
+        return;
+    }
+
+    config_reload_requested = 0;
+
+    // Build the whole block here (log table included), the control step only swaps a pointer
+    ControlParameters parameters;
+
+    if (!loadConfig(main_argc, main_argv, DEFAULT_PARAMETERS, parameters)) {
+
+        fprintf(stderr, "configuration not reloaded\n");
+        return;
+
+    }
+
+#if LINE_FILTER == 1
+    // The Butterworth coefficients are designed for the startup period, another one would move the cutoff
+    if (parameters.dt_us != filter_dt_us) {
+
+        fprintf(stderr, "dt_us cannot change with the Butterworth filter (LINE_FILTER 1, designed for %d us), configuration not reloaded\n", filter_dt_us);
+        return;
+
+    }
+#endif
+
+    configuration->publish(new ControlConfig(parameters, LINE_SENSOR_SCALE));
+
+    printf("Configuration reloaded: kp %g ki %g kd %g speed %g filter_alpha %g log_diff_bias %g dt_us %d\n",
+           parameters.kp, parameters.ki, parameters.kd, parameters.speed, parameters.filter_alpha, parameters.log_diff_bias, parameters.dt_us);
+
+}
+
+
+void requestConfigReload(int sig) {
+
+    config_reload_requested = 1;
+
+}
+
+
+void telemetryStep() {
+
+    telemetry.flush();
+
+}
+
+
+void telemetryStreamStep() {
+
+    telemetry_stream.service();
+
+}
+
+
+void statsStep() {
+
+    if (latency_dump_requested) {
+
+        latency_dump_requested = 0;
+        dumpLatency(LATENCY_FILE);
+
+        if (i2c_tracer.isEnabled()) {
+            i2c_tracer.dump(I2C_TRACE_FILE);
+        }
+
+    }
+
+}
+
+
+void printSchedulerStats(const char* name, TaskScheduler* scheduler) {
+
+    TimingStats stats = scheduler->getTimer().getStats();
+
+    printf("%s loop: %llu cycles, %llu missed deadlines, period %.1f us (min %.1f, max %.1f, jitter %.1f), max lateness %.1f us\n",
+           name, (unsigned long long) stats.cycles, (unsigned long long) stats.missed, stats.mean_period_ns * 1e-3,
+           stats.min_period_ns * 1e-3, stats.max_period_ns * 1e-3, stats.jitter_ns * 1e-3, stats.max_lateness_ns * 1e-3);
+
+    for (const PeriodicTask& task : scheduler->getTasks()) {
+        printf("  %s: %llu runs, max %.1f us\n", task.name, (unsigned long long) task.runs, task.max_duration_ns * 1e-3);
+    }
+
+}
@@ -3,15 +3,9 @@
 #include <stdexcept>
 #include <stdio.h>
 #include <unistd.h>
-#include <sys/ioctl.h>
-#include <fcntl.h>
 #include <math.h>
 
-extern "C" {
-#include <linux/i2c-dev.h>
-#include <i2c/smbus.h>
-}
-
+#include "i2c.hpp"
 #include "utilities.hpp"
 
 #define RPI_I2C_FILE "/dev/i2c-1"
@@ -48,120 +42,255 @@ extern "C" {
 
 #define BATT 0x13
 
-#define ADC_VREF 3.3
-#define ADC_RESO 4095.0
 #define BAT_VDIV 3.0
 
+#define MAX_BATCHED_WRITES 8
+
+// Indices of the lines in the GPIO request
+#define GPIO_IDX_MOT1_DIR 0
+#define GPIO_IDX_MOT2_DIR 1
+#define GPIO_IDX_MCU_RST  2
+#define GPIO_LINES        3
+
+static const uint8_t ADC_REGISTERS[ADC_CHANNELS] = { A0, A1, A2, A3, BATT };
+
 PiCarX::PiCarX() {
 
     this->i2cfd = -1;
     this->gpio = NULL;
-    this->mot1_dir_line = NULL;
-    this->mot2_dir_line = NULL;
-    this->mcu_rst_line  = NULL;
+    this->warm = false;
+
+    this->invalidateCache();
+    this->resetWriteStats();
 
 }
 
 
-void write_to_chip(uint8_t i2cfd, uint8_t reg, uint16_t data) {
+int write_to_chip(uint8_t i2cfd, uint8_t reg, uint16_t data) {
 
 
-    uint16_t reversed = ((data & 0xff) << 8) + (data >> 8);
-    i2c_smbus_write_word_data(i2cfd, reg, reversed);
+    return i2cWriteWord(i2cfd, reg, i2cSwapBytes(data));
     
 }
 
 
+uint16_t motor_pulse_width(float speed) {
 
-uint16_t read_from_chip(uint8_t i2cfd, uint8_t reg) {
+    // Calculate pulse width in number of ticks
+    return fabs(speed) * MCU_PWM_TICK;
 
+}
 
-    write_to_chip(i2cfd, reg, 0);
-    uint16_t high = i2c_smbus_read_byte(i2cfd);
-    uint16_t low  = i2c_smbus_read_byte(i2cfd);
-    return (high << 8) + low;
+
+uint16_t steering_pulse_width(float angle) {
+
+    // Saturate angle between min and max
+    angle = saturate(angle, STEERING_MIN_ANGLE, STEERING_MAX_ANGLE);
+
+    // Convert angle to microseconds
+    float microsec = map(angle, SERVO_MIN_ANGLE, SERVO_MAX_ANGLE, SERVO_LEFT, SERVO_RIGHT);
+
+    // Convert microseconds to duty cycle
+    float duty_cycle = microsec / SERVO_PERIOD_US;
+
+    // Calculate pulse width in number of ticks
+    return duty_cycle * MCU_PWM_TICK;
 
 }
 
 
-void PiCarX::connect() {
+bool PiCarX::writeRegisters(const uint8_t regs[], const uint16_t values[], int count) {
 
-    // Connect to GPIO chip
-    this->gpio = gpiod_chip_open_by_number(RPI_GPIO_CHIP);
+    // Each register write is a (register, high byte, low byte) message, as sent by write_to_chip
+    uint8_t buffers[MAX_BATCHED_WRITES][3];
+    struct i2c_msg msgs[MAX_BATCHED_WRITES];
+    uint8_t dirty[MAX_BATCHED_WRITES];
+    uint32_t nmsgs = 0;
+    bool acknowledged = true;
 
-    if (gpio == NULL) {
+    for (int i = 0; i < count; i++) {
 
-        perror("gpio chip failed to open");
-        return;
+        if (this->registers_known[regs[i]] && this->registers[regs[i]] == values[i]) {
 
-    }
+            this->stats.register_skips++;
+            continue;
+
+        }
 
-    // Claim GPIO lines
-    this->mot1_dir_line = gpiod_chip_get_line(gpio, MOTOR1_DIR_GPIO);
+        // A full batch goes out before the next write is queued
+        if (nmsgs == MAX_BATCHED_WRITES) {
 
-    if (this->mot1_dir_line == NULL) {
+            acknowledged &= this->transferWrites(msgs, dirty, nmsgs);
+            nmsgs = 0;
 
-        perror("motor 1 direction line failed to open");
-        this->disconnect();
-        return;
+        }
+
+        buffers[nmsgs][0] = regs[i];
+        buffers[nmsgs][1] = values[i] >> 8;
+        buffers[nmsgs][2] = values[i] & 0xff;
+
+        msgs[nmsgs].addr  = MCU_I2C_ADDR;
+        msgs[nmsgs].flags = 0;
+        msgs[nmsgs].len   = sizeof(buffers[nmsgs]);
+        msgs[nmsgs].buf   = buffers[nmsgs];
+
+        dirty[nmsgs] = regs[i];
+        this->registers[regs[i]] = values[i];
+        nmsgs++;
 
     }
 
-    this->mot2_dir_line = gpiod_chip_get_line(gpio, MOTOR2_DIR_GPIO);
+    if (nmsgs > 0) {
+        acknowledged &= this->transferWrites(msgs, dirty, nmsgs);
+    }
 
-    if (this->mot2_dir_line == NULL) {
+    return acknowledged;
 
-        perror("motor 2 direction line failed to open");
-        this->disconnect();
-        return;
+}
+
+
+bool PiCarX::transferWrites(struct i2c_msg msgs[], const uint8_t dirty[], uint32_t count) {
+
+    this->stats.register_writes += count;
+
+    // Only trust the shadow copy if the MCU acknowledged the writes
+    bool acknowledged = i2cTransfer(this->i2cfd, msgs, count) >= 0;
 
+    for (uint32_t i = 0; i < count; i++) {
+        this->registers_known[dirty[i]] = acknowledged;
     }
 
-    this->mcu_rst_line = gpiod_chip_get_line(gpio, MCU_RST_GPIO);
+    return acknowledged;
 
-    if (this->mcu_rst_line == NULL) {
+}
+
+
+void PiCarX::writeRegister(uint8_t reg, uint16_t value) {
+
+    this->writeRegisters(&reg, &value, 1);
+
+}
 
-        perror("mcu reset line failed to open");
-        this->disconnect();
-        return;
 
+void PiCarX::setDirection(int direction) {
+
+    // The whole request is written at once, the MCU reset line is held released
+    int values[GPIO_LINES];
+
+    values[GPIO_IDX_MOT1_DIR] = direction;
+    values[GPIO_IDX_MOT2_DIR] = !direction;
+    values[GPIO_IDX_MCU_RST]  = 1;
+
+    int result = this->lines.set(values);
+
+    // Counted rather than reported, this runs on every actuator frame
+    if (result < 0) {
+        this->stats.gpio_errors++;
+    } else if (result == 0) {
+        this->stats.gpio_skips++;
+    } else {
+        this->stats.gpio_writes++;
     }
 
-    // Set GPIO lines to output
-    if (gpiod_line_request_output(this->mot1_dir_line, "motor 1 direction", 0) < 0) {
+}
 
-        perror("motor 1 direction line failed to set as output");
-        this->disconnect();
-        return;
+
+void PiCarX::pulseReset(int direction) {
+
+    int values[GPIO_LINES];
+
+    values[GPIO_IDX_MOT1_DIR] = direction;
+    values[GPIO_IDX_MOT2_DIR] = direction;
+
+    const int pulse[3] = { 1, 0, 1 };
+
+    for (int i = 0; i < 3; i++) {
+
+        values[GPIO_IDX_MCU_RST] = pulse[i];
+        this->lines.set(values);
+        usleep(10000);
 
     }
 
-    if (gpiod_line_request_output(this->mot2_dir_line, "motor 2 direction", 0) < 0) {
+}
 
-        perror("motor 2 direction line failed to set as output");
-        this->disconnect();
+
+
+uint16_t read_from_chip(uint8_t i2cfd, uint8_t reg) {
+
+
+    write_to_chip(i2cfd, reg, 0);
+    uint16_t high = i2cReadByte(i2cfd);
+    uint16_t low  = i2cReadByte(i2cfd);
+    return (high << 8) + low;
+
+}
+
+
+bool PiCarX::probe() {
+
+    uint16_t raw[ADC_CHANNELS];
+
+    // A MCU held in reset does not acknowledge, a running one reads a battery above 0 V
+    return this->readChannelsRaw(ADC_MASK_BATT, raw) && raw[ADC_IDX_BATT] > 0;
+
+}
+
+
+void PiCarX::configure() {
+
+    // Rewriting the timers of a configured MCU is harmless, so both connect paths share this
+    const uint8_t regs[7] = {
+        STEERING_PWM_TIMER_PRESCL_REG, STEERING_PWM_TIMER_PERIOD_REG,
+        MOTOR_PWM_TIMER_PRESCL_REG, MOTOR_PWM_TIMER_PERIOD_REG,
+        STEERING_PWM_CHAN, MOTOR1_PWM_CHAN, MOTOR2_PWM_CHAN
+    };
+
+    const uint16_t values[7] = {
+        STEERING_PWM_TIMER_PRESCL_VAL, MCU_PWM_TICK,
+        MOTOR_PWM_TIMER_PRESCL_VAL, MCU_PWM_TICK,
+        steering_pulse_width(0), motor_pulse_width(0), motor_pulse_width(0)
+    };
+
+    this->setDirection(0);
+    this->writeRegisters(regs, values, 7);
+
+}
+
+
+void PiCarX::connect(bool warm) {
+
+    this->warm = false;
+
+    // Connect to GPIO chip
+    this->gpio = gpiod_chip_open_by_number(RPI_GPIO_CHIP);
+
+    if (gpio == NULL) {
+
+        perror("gpio chip failed to open");
         return;
 
     }
 
-    if (gpiod_line_request_output(this->mcu_rst_line, "mcu reset", 0) < 0) {
+    // Claim the direction and reset lines as outputs in a single request. A cold start holds
+    // the MCU in reset, a warm start requests the reset line released so a running MCU keeps running
+    const unsigned int offsets[GPIO_LINES] = { MOTOR1_DIR_GPIO, MOTOR2_DIR_GPIO, MCU_RST_GPIO };
+    const int defaults[GPIO_LINES] = { 0, 0, warm ? 1 : 0 };
+
+    if (!this->lines.request(this->gpio, offsets, defaults, GPIO_LINES, "picarx")) {
 
-        perror("mcu reset line failed to set as output");
         this->disconnect();
         return;
 
     }
 
     // Reset MCU
-    gpiod_line_set_value(this->mcu_rst_line, 1);
-    usleep(10000);
-    gpiod_line_set_value(this->mcu_rst_line, 0);
-    usleep(10000);
-    gpiod_line_set_value(this->mcu_rst_line, 1);
-    usleep(10000);
+    if (!warm) {
+        this->pulseReset(0);
+    }
 
     // Open I2C file descriptor
-    this->i2cfd = open(RPI_I2C_FILE, O_RDWR);
+    this->i2cfd = i2cOpen(RPI_I2C_FILE);
 
     if (this->i2cfd < 0) {
 
@@ -170,82 +299,119 @@ void PiCarX::connect() {
     }
 
     // Set I2C slave address
-    if (ioctl(this->i2cfd, I2C_SLAVE, MCU_I2C_ADDR) < 0) {
+    if (i2cSetAddress(this->i2cfd, MCU_I2C_ADDR) < 0) {
 
         // Close I2C file descriptor
-        close(this->i2cfd);
+        i2cClose(this->i2cfd);
         this->i2cfd = -1;
 
         // Release GPIO lines
-        gpiod_line_release(this->mot1_dir_line);
-        gpiod_line_release(this->mot2_dir_line);
-        gpiod_line_release(this->mcu_rst_line);
-
-        // Set GPIO lines to NULL
-        this->mot1_dir_line = NULL;
-        this->mot2_dir_line = NULL;
-        this->mcu_rst_line  = NULL;
+        this->lines.release();
 
         return;
 
     }
 
-    // Iniialze steering
-    write_to_chip(i2cfd, STEERING_PWM_TIMER_PRESCL_REG, STEERING_PWM_TIMER_PRESCL_VAL);
-    write_to_chip(i2cfd, STEERING_PWM_TIMER_PERIOD_REG, MCU_PWM_TICK);
-    this->setSteeringAngle(0);
+    // Whether the MCU was just reset or written by another process, nothing in the shadow copy can be trusted
+    this->invalidateCache();
+
+    if (warm) {
+
+        this->warm = this->probe();
+
+        // Fall back to a cold start
+        if (!this->warm) {
+            this->pulseReset(0);
+        }
+
+    }
+
+    // Initialize steering and motors
+    this->configure();
+
+}
+
 
-    // Initialize motors
-    write_to_chip(i2cfd, MOTOR_PWM_TIMER_PRESCL_REG, MOTOR_PWM_TIMER_PRESCL_VAL);
-    write_to_chip(i2cfd, MOTOR_PWM_TIMER_PERIOD_REG, MCU_PWM_TICK);
-    this->setMotorSpeed(0);
+bool PiCarX::isWarmStart() {
+
+    return this->warm;
 
 }
 
 
 void PiCarX::setMotorSpeed(float speed) {
 
-    // Get direction and duty cycle
-    uint16_t direction = (speed >= 0) ? 0 : 1;
-    float duty_cycle = fabs(speed);
-
     // Set direction
-    gpiod_line_set_value(this->mot1_dir_line, direction);
-    gpiod_line_set_value(this->mot2_dir_line, !direction);
-
-    // Calculate pulse width in number of ticks
-    uint16_t pulse_width = duty_cycle * MCU_PWM_TICK;
+    this->setDirection((speed >= 0) ? 0 : 1);
 
     // Set PWM of the motors
-    write_to_chip(i2cfd, MOTOR1_PWM_CHAN, pulse_width);
-    write_to_chip(i2cfd, MOTOR2_PWM_CHAN, pulse_width);
+    const uint8_t  regs[2]   = { MOTOR1_PWM_CHAN, MOTOR2_PWM_CHAN };
+    const uint16_t values[2] = { motor_pulse_width(speed), motor_pulse_width(speed) };
+
+    this->writeRegisters(regs, values, 2);
 
 }
 
 
 void PiCarX::setSteeringAngle(float angle) {
 
-    // Saturate angle between min and max
-    angle = saturate(angle, STEERING_MIN_ANGLE, STEERING_MAX_ANGLE);
+    // Set PWM of the steering servo
+    this->writeRegister(STEERING_PWM_CHAN, steering_pulse_width(angle));
 
-    // Convert angle to microseconds
-    float microsec = map(angle, SERVO_MIN_ANGLE, SERVO_MAX_ANGLE, SERVO_LEFT, SERVO_RIGHT);
+}
 
-    // Convert microseconds to duty cycle
-    float duty_cycle = microsec / SERVO_PERIOD_US;
 
-    // Calculate pulse width in number of ticks
-    uint16_t pulse_width = duty_cycle * MCU_PWM_TICK;
+void PiCarX::applyActuatorFrame(const ActuatorFrame& frame) {
 
-    // Set PWM of the steering servo
-    write_to_chip(i2cfd, STEERING_PWM_CHAN, pulse_width);
+    // Set direction
+    this->setDirection((frame.speed >= 0) ? 0 : 1);
+
+    // Set PWM of the motors and the steering servo in a single transaction
+    uint16_t motor_pulse = motor_pulse_width(frame.speed);
+
+    const uint8_t  regs[3]   = { MOTOR1_PWM_CHAN, MOTOR2_PWM_CHAN, STEERING_PWM_CHAN };
+    const uint16_t values[3] = { motor_pulse, motor_pulse, steering_pulse_width(frame.angle) };
+
+    this->writeRegisters(regs, values, 3);
 
 }
 
 
 bool PiCarX::isConnected() {
     
-    return this->i2cfd >= 0 && this->mot1_dir_line != NULL && this->mot2_dir_line != NULL && this->mcu_rst_line != NULL;
+    return this->i2cfd >= 0 && this->lines.isRequested();
+
+}
+
+
+void PiCarX::invalidateCache() {
+
+    for (int i = 0; i < MCU_REGISTERS; i++) {
+
+        this->registers[i] = 0;
+        this->registers_known[i] = false;
+
+    }
+
+    this->lines.invalidate();
+
+}
+
+
+WriteStats PiCarX::getWriteStats() {
+
+    return this->stats;
+
+}
+
+
+void PiCarX::resetWriteStats() {
+
+    this->stats.register_writes = 0;
+    this->stats.register_skips  = 0;
+    this->stats.gpio_writes     = 0;
+    this->stats.gpio_skips      = 0;
+    this->stats.gpio_errors     = 0;
 
 }
 
@@ -265,78 +431,194 @@ float PiCarX::getAnalogVoltage(uint8_t channel) {
 }
 
 
-float PiCarX::getBatteryVoltage() {
+bool PiCarX::readChannelsRaw(uint8_t mask, uint16_t out[ADC_CHANNELS], uint64_t* timestamp) {
 
-    uint16_t raw = read_from_chip(this->i2cfd, BATT);
+    if (mask == 0 || (mask & ~ADC_MASK_ALL) != 0) {
 
-    float divided = raw * ADC_VREF / ADC_RESO;
+        throw std::invalid_argument("Invalid channel mask: must be a combination of ADC_MASK_*");
 
-    float batterVoltage = divided * BAT_VDIV;
+    }
 
-    return batterVoltage;
+    // One command (register, 0, 0) and one 2 byte reply per channel, all sent with repeated starts
+    uint8_t commands[ADC_CHANNELS][3];
+    uint8_t replies[ADC_CHANNELS][2];
+    struct i2c_msg msgs[2 * ADC_CHANNELS];
+    uint32_t nmsgs = 0;
 
-}
+    for (int i = 0; i < ADC_CHANNELS; i++) {
 
+        if ((mask & (1 << i)) == 0) {
+            continue;
+        }
 
-void PiCarX::disconnect() {
+        commands[i][0] = ADC_REGISTERS[i];
+        commands[i][1] = 0;
+        commands[i][2] = 0;
 
-    if (this->i2cfd >= 0) {
+        msgs[nmsgs].addr  = MCU_I2C_ADDR;
+        msgs[nmsgs].flags = 0;
+        msgs[nmsgs].len   = sizeof(commands[i]);
+        msgs[nmsgs].buf   = commands[i];
+        nmsgs++;
 
-        close(this->i2cfd);
-        this->i2cfd = -1;
+        msgs[nmsgs].addr  = MCU_I2C_ADDR;
+        msgs[nmsgs].flags = I2C_M_RD;
+        msgs[nmsgs].len   = sizeof(replies[i]);
+        msgs[nmsgs].buf   = replies[i];
+        nmsgs++;
+
+    }
+
+    uint64_t start = monotonicTime();
+
+    if (i2cTransfer(this->i2cfd, msgs, nmsgs) < 0) {
 
+        return false;
+
+    }
+
+    uint64_t end = monotonicTime();
+
+    // All channels share the midpoint of the transaction as their acquisition time
+    if (timestamp != NULL) {
+        *timestamp = start + (end - start) / 2;
     }
 
-    if (this->mot1_dir_line != NULL) {
+    for (int i = 0; i < ADC_CHANNELS; i++) {
 
-        // Check that GPIO line is set to output and pull GPIO line low
-        if (gpiod_line_direction(this->mot1_dir_line) == GPIOD_LINE_DIRECTION_OUTPUT) {
-            gpiod_line_set_value(this->mot1_dir_line, 0);
+        if (mask & (1 << i)) {
+            out[i] = ((uint16_t) replies[i][0] << 8) + replies[i][1];
         }
 
-        // Release GPIO line
-        gpiod_line_release(this->mot1_dir_line);
+    }
+
+    return true;
+
+}
 
-        // Set GPIO line to NULL
-        this->mot1_dir_line = NULL;
+
+bool PiCarX::readChannels(uint8_t mask, float out[ADC_CHANNELS], uint64_t* timestamp) {
+
+    uint16_t raw[ADC_CHANNELS];
+
+    if (!this->readChannelsRaw(mask, raw, timestamp)) {
+
+        return false;
 
     }
 
-    if (this->mot2_dir_line != NULL) {
+    for (int i = 0; i < ADC_CHANNELS; i++) {
 
-        // Check that GPIO line is set to output and pull GPIO line low
-        if (gpiod_line_direction(this->mot2_dir_line) == GPIOD_LINE_DIRECTION_OUTPUT) {
-            gpiod_line_set_value(this->mot2_dir_line, 0);
+        if (mask & (1 << i)) {
+            out[i] = PiCarX::toVoltage(i, raw[i]);
         }
 
-        // Release GPIO line
-        gpiod_line_release(this->mot2_dir_line);
+    }
+
+    return true;
 
-        // Set GPIO line to NULL
-        this->mot2_dir_line = NULL;
+}
+
+
+bool PiCarX::readFrame(uint8_t mask, SensorFrame& frame) {
+
+    if (!this->readChannelsRaw(mask, frame.raw, &frame.timestamp)) {
+
+        return false;
 
     }
 
-    if (this->mcu_rst_line != NULL) {
+    frame.mask = mask;
 
-        // Check that GPIO line is set to output and reset MCU if it is
-        if (gpiod_line_direction(this->mcu_rst_line) == GPIOD_LINE_DIRECTION_OUTPUT) {
+    return true;
 
-            // Reset MCU and keep it in reset state
-            gpiod_line_set_value(this->mcu_rst_line, 1);
-            usleep(10000);
-            gpiod_line_set_value(this->mcu_rst_line, 0);
-            usleep(10000);
-            gpiod_line_set_value(this->mcu_rst_line, 1);
-            usleep(10000);
+}
 
-        }
 
-        // Release GPIO line
-        gpiod_line_release(this->mcu_rst_line);
+uint16_t PiCarX::steeringPulseWidth(float angle) {
+
+    return steering_pulse_width(angle);
+
+}
+
+
+SteeringMap PiCarX::steeringMap() {
+
+    SteeringMap map;
+
+    map.min_angle = STEERING_MIN_ANGLE;
+    map.max_angle = STEERING_MAX_ANGLE;
+
+    // Same chain as steering_pulse_width: angle -> microseconds -> duty cycle -> ticks
+    double ticks_per_us = MCU_PWM_TICK / SERVO_PERIOD_US;
+    double us_per_degree = (SERVO_RIGHT - SERVO_LEFT) / (SERVO_MAX_ANGLE - SERVO_MIN_ANGLE);
+
+    map.ticks_at_zero = (SERVO_LEFT - SERVO_MIN_ANGLE * us_per_degree) * ticks_per_us;
+    map.ticks_per_degree = us_per_degree * ticks_per_us;
 
-        // Set GPIO line to NULL
-        this->mcu_rst_line = NULL;
+    return map;
+
+}
+
+
+float PiCarX::toVoltage(int index, uint16_t raw) {
+
+    float divided = raw * ADC_VREF / ADC_RESO;
+
+    return (index == ADC_IDX_BATT) ? divided * BAT_VDIV : divided;
+
+}
+
+
+float PiCarX::getBatteryVoltage() {
+
+    uint16_t raw = read_from_chip(this->i2cfd, BATT);
+
+    float divided = raw * ADC_VREF / ADC_RESO;
+
+    float batterVoltage = divided * BAT_VDIV;
+
+    return batterVoltage;
+
+}
+
+
+void PiCarX::disconnect(bool reset) {
+
+    // Without a reset the MCU keeps driving its outputs, stop the motors first
+    if (!reset && this->i2cfd >= 0) {
+        this->setMotorSpeed(0);
+    }
+
+    if (this->i2cfd >= 0) {
+
+        i2cClose(this->i2cfd);
+        this->i2cfd = -1;
+
+    }
+
+    if (this->lines.isRequested()) {
+
+        if (reset) {
+
+            // Pull the direction lines low, then reset the MCU and keep it in reset state
+            this->pulseReset(0);
+
+        } else {
+
+            // Pull both direction lines low and leave the MCU running (the lines keep their values once released)
+            int values[GPIO_LINES];
+
+            values[GPIO_IDX_MOT1_DIR] = 0;
+            values[GPIO_IDX_MOT2_DIR] = 0;
+            values[GPIO_IDX_MCU_RST]  = 1;
+
+            this->lines.set(values);
+
+        }
+
+        // Release GPIO lines
+        this->lines.release();
 
     }
 
@@ -347,6 +629,8 @@ void PiCarX::disconnect() {
 
     }
 
+    this->invalidateCache();
+
 }
 
 
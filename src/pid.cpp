@@ -1,5 +1,7 @@
 #include "pid.hpp"
 
+#include "utilities.hpp"
+
 
 PIDController::PIDController(float kp, float ki, float kd, float dt) {
 
@@ -10,6 +12,8 @@ PIDController::PIDController(float kp, float ki, float kd, float dt) {
 
     this->ierr = 0.0f;
     this->derr = 0.0f;
+    this->pterm = 0.0f;
+    this->dterm = 0.0f;
 
 }
 
@@ -20,7 +24,10 @@ float PIDController::pass(float setpoint, float value) {
 
     this->ierr += ki * err * dt;
 
-    float response = kp * err + this->ierr + kd * (err - this->derr) / dt;
+    this->pterm = kp * err;
+    this->dterm = kd * (err - this->derr) / dt;
+
+    float response = this->pterm + this->ierr + this->dterm;
 
     this->derr = err;
 
@@ -29,10 +36,21 @@ float PIDController::pass(float setpoint, float value) {
 }
 
 
+void PIDController::getTerms(float& p, float& i, float& d) const {
+
+    p = this->pterm;
+    i = this->ierr;
+    d = this->dterm;
+
+}
+
+
 void PIDController::reset() {
 
     this->ierr = 0.0f;
     this->derr = 0.0f;
+    this->pterm = 0.0f;
+    this->dterm = 0.0f;
 
 }
 
@@ -42,3 +60,113 @@ PIDController::~PIDController() {
 
 }
 
+
+RobustPIDController::RobustPIDController(float kp, float ki, float kd, float out_min, float out_max, float dt_max,
+                                         float tau, AntiWindup anti_windup, float kb) {
+
+    this->tau = tau;
+    this->out_min = out_min;
+    this->out_max = out_max;
+    this->dt_max = dt_max;
+    this->anti_windup = anti_windup;
+
+    this->kb = kb;
+    this->kb_default = kb <= 0.0f;
+
+    this->setGains(kp, ki, kd);
+    this->reset();
+
+}
+
+
+float RobustPIDController::pass(float setpoint, float value, float dt) {
+
+    dt = saturate(dt, 0.0f, this->dt_max);
+
+    float err = setpoint - value;
+
+    this->pterm = this->kp * err;
+
+    // Filtered derivative of the measurement (backward Euler), skipped without a previous measurement or elapsed time
+    if (this->started && dt > 0.0f) {
+        this->dterm = (this->tau * this->dterm - this->kd * (value - this->previous)) / (this->tau + dt);
+    }
+
+    this->previous = value;
+    this->started = true;
+
+    float integral = this->iterm + this->ki * err * dt;
+    float response = this->pterm + integral + this->dterm;
+    float output = saturate(response, this->out_min, this->out_max);
+
+    this->saturated = output != response;
+
+    switch (this->anti_windup) {
+
+        case ANTI_WINDUP_CLAMP:
+
+            // Keep the integral when the error pushes the output further into saturation
+            if (!(this->saturated && (response - output) * err > 0.0f)) {
+                this->iterm = integral;
+            }
+
+            break;
+
+        case ANTI_WINDUP_BACK_CALCULATION:
+
+            // Without an integral gain nothing would ever bleed the tracking term back out
+            this->iterm = (this->ki != 0.0f) ? integral + this->kb * (output - response) * dt : integral;
+            break;
+
+        default:
+
+            this->iterm = integral;
+            break;
+
+    }
+
+    return output;
+
+}
+
+
+void RobustPIDController::getTerms(float& p, float& i, float& d) const {
+
+    p = this->pterm;
+    i = this->iterm;
+    d = this->dterm;
+
+}
+
+
+bool RobustPIDController::isSaturated() const {
+
+    return this->saturated;
+
+}
+
+
+void RobustPIDController::setGains(float kp, float ki, float kd) {
+
+    this->kp = kp;
+    this->ki = ki;
+    this->kd = kd;
+
+    // Track ten times faster than the integral acts by default (Tt = Ti / 10), nothing to track without an integral
+    if (this->kb_default) {
+        this->kb = (ki == 0.0f) ? 0.0f : (kp != 0.0f) ? 10.0f * ki / kp : 1.0f / this->dt_max;
+    }
+
+}
+
+
+void RobustPIDController::reset() {
+
+    this->iterm = 0.0f;
+    this->dterm = 0.0f;
+    this->pterm = 0.0f;
+    this->previous = 0.0f;
+    this->started = false;
+    this->saturated = false;
+
+}
@@ -0,0 +1,147 @@
+#include "sampler.hpp"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <system_error>
+
+#include "utilities.hpp"
+
+
+Sampler::Sampler(PiCarX* picarx, uint8_t mask, int interval_us) {
+
+    this->picarx = picarx;
+    this->mask = mask;
+    this->interval_us = interval_us;
+
+    this->failed_reads = 0;
+    this->running = false;
+
+}
+
+
+bool Sampler::start() {
+
+    if (!this->running) {
+
+        this->running = true;
+
+        try {
+
+            this->sampler_thread = std::thread(&Sampler::run, this);
+
+        } catch (const std::system_error& e) {
+
+            fprintf(stderr, "sampler thread failed to start: %s\n", e.what());
+            this->running = false;
+            return false;
+
+        }
+
+    }
+
+    return true;
+
+}
+
+
+void Sampler::stop() {
+
+    if (this->running) {
+
+        this->running = false;
+        this->sampler_thread.join();
+
+    }
+
+}
+
+
+void Sampler::run() {
+
+    uint64_t interval_ns = (uint64_t) this->interval_us * 1000;
+    uint64_t next_sample = monotonicTime();
+    useconds_t backoff_us = 0;
+
+    SensorFrame frame;
+
+    while (this->running.load(std::memory_order_acquire)) {
+
+        if (interval_ns > 0) {
+
+            uint64_t now = monotonicTime();
+
+            if (now < next_sample) {
+                usleep((next_sample - now) / 1000);
+            }
+
+            next_sample += interval_ns;
+
+            if (next_sample < now) {
+                next_sample = now + interval_ns;
+            }
+
+        }
+
+        if (!this->picarx->readFrame(this->mask, frame)) {
+
+            this->failed_reads++;
+
+            // Back off while the MCU does not answer, the thread runs at a real-time priority
+            backoff_us = (backoff_us == 0) ? SAMPLER_BACKOFF_MIN_US : std::min(2 * backoff_us, (useconds_t) SAMPLER_BACKOFF_MAX_US);
+            usleep(backoff_us);
+
+            continue;
+
+        }
+
+        backoff_us = 0;
+
+        this->frames.push(frame);
+
+    }
+
+}
+
+
+bool Sampler::latest(SensorFrame& frame) const {
+
+    return this->frames.latest(frame);
+
+}
+
+
+int Sampler::window(SensorFrame frames[], int count) const {
+
+    // Frames overwritten while copying are skipped
+    return (count > 0) ? (int) this->frames.snapshot(frames, count) : 0;
+
+}
+
+
+uint64_t Sampler::getCount() const {
+
+    return this->frames.count();
+
+}
+
+
+uint64_t Sampler::getFailedReads() const {
+
+    return this->failed_reads;
+
+}
+
+
+pthread_t Sampler::nativeHandle() {
+
+    return this->sampler_thread.native_handle();
+
+}
+
+
+Sampler::~Sampler() {
+
+    this->stop();
+
+}
@@ -0,0 +1,379 @@
+#include "scheduler.hpp"
+
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <algorithm>
+#include <system_error>
+
+#include "utilities.hpp"
+
+
+PeriodicTimer::PeriodicTimer(uint64_t period_ns) {
+
+    this->period_ns = period_ns;
+    this->deadline = 0;
+    this->last_wakeup = 0;
+    this->index = 0;
+    this->next_index = 0;
+
+    this->resetStats();
+
+}
+
+
+void PeriodicTimer::start(uint64_t origin) {
+
+    this->last_wakeup = monotonicTime();
+    this->deadline = (origin == 0) ? this->last_wakeup + this->period_ns : origin;
+    this->next_index = 0;
+
+    // First deadline aligned to the origin and strictly in the future (index 0 is the origin itself)
+    if (this->deadline <= this->last_wakeup) {
+
+        uint64_t elapsed = (this->last_wakeup - this->deadline) / this->period_ns + 1;
+
+        this->deadline += elapsed * this->period_ns;
+        this->next_index += elapsed;
+
+    }
+
+    this->index = this->next_index;
+
+}
+
+
+bool PeriodicTimer::wait() {
+
+    bool on_time = monotonicTime() < this->deadline;
+
+    if (on_time) {
+
+        struct timespec ts;
+        ts.tv_sec  = this->deadline / 1000000000ull;
+        ts.tv_nsec = this->deadline % 1000000000ull;
+
+        // Restart the sleep on signals, the deadline is absolute so nothing drifts
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+    } else {
+
+        this->stats.missed++;
+
+    }
+
+    uint64_t now = monotonicTime();
+
+    // Update the period statistics (Welford)
+    int64_t period = (int64_t) (now - this->last_wakeup);
+    int64_t lateness = (int64_t) (now - this->deadline);
+
+    this->stats.cycles++;
+
+    double delta = period - this->stats.mean_period_ns;
+    this->stats.mean_period_ns += delta / this->stats.cycles;
+    this->period_m2 += delta * (period - this->stats.mean_period_ns);
+    this->stats.jitter_ns = sqrt(this->period_m2 / this->stats.cycles);
+
+    if (this->stats.cycles == 1 || period < this->stats.min_period_ns) {
+        this->stats.min_period_ns = period;
+    }
+
+    if (period > this->stats.max_period_ns) {
+        this->stats.max_period_ns = period;
+    }
+
+    if (lateness > this->stats.max_lateness_ns) {
+        this->stats.max_lateness_ns = lateness;
+    }
+
+    this->last_wakeup = now;
+
+    // Advance the deadline, skipping the periods that already elapsed
+    this->index = this->next_index;
+    this->deadline += this->period_ns;
+    this->next_index++;
+
+    if (this->deadline <= now) {
+
+        uint64_t skipped = (now - this->deadline) / this->period_ns + 1;
+
+        this->deadline += skipped * this->period_ns;
+        this->next_index += skipped;
+
+    }
+
+    return on_time;
+
+}
+
+
+bool PeriodicTimer::waitUntil(uint64_t index) {
+
+    if (index > this->next_index) {
+
+        this->deadline += (index - this->next_index) * this->period_ns;
+        this->next_index = index;
+
+    }
+
+    return this->wait();
+
+}
+
+
+void PeriodicTimer::setPeriod(uint64_t period_ns) {
+
+    this->deadline += period_ns - this->period_ns;
+    this->period_ns = period_ns;
+
+}
+
+
+uint64_t PeriodicTimer::getIndex() {
+
+    return this->index;
+
+}
+
+
+uint64_t PeriodicTimer::getPeriod() {
+
+    return this->period_ns;
+
+}
+
+
+TimingStats PeriodicTimer::getStats() {
+
+    return this->stats;
+
+}
+
+
+void PeriodicTimer::resetStats() {
+
+    this->stats.cycles = 0;
+    this->stats.missed = 0;
+    this->stats.mean_period_ns = 0.0;
+    this->stats.jitter_ns = 0.0;
+    this->stats.min_period_ns = 0;
+    this->stats.max_period_ns = 0;
+    this->stats.max_lateness_ns = 0;
+
+    this->period_m2 = 0.0;
+
+}
+
+
+TaskScheduler::TaskScheduler(uint64_t tick_ns) : timer(tick_ns) {
+
+    this->tick_ns = tick_ns;
+    this->tick = 0;
+    this->running = false;
+
+}
+
+
+void TaskScheduler::add(const char* name, uint64_t period_ns, uint64_t phase_ns, int priority, std::function<void()> run) {
+
+    PeriodicTask task;
+
+    task.name = name;
+    task.period = (period_ns < this->tick_ns) ? 1 : period_ns / this->tick_ns;
+    task.phase = (phase_ns / this->tick_ns) % task.period;
+    task.priority = priority;
+    task.run = run;
+    task.runs = 0;
+    task.max_duration_ns = 0;
+
+    this->tasks.push_back(task);
+
+    std::stable_sort(this->tasks.begin(), this->tasks.end(), [](const PeriodicTask& a, const PeriodicTask& b) {
+        return a.priority < b.priority;
+    });
+
+}
+
+
+uint64_t TaskScheduler::nextRun(const PeriodicTask& task, uint64_t from) {
+
+    uint64_t due = task.phase;
+
+    if (due < from) {
+        due += (from - due + task.period - 1) / task.period * task.period;
+    }
+
+    return due;
+
+}
+
+
+void TaskScheduler::run(uint64_t origin) {
+
+    this->running = true;
+    this->timer.start(origin);
+    this->tick = this->timer.getIndex();
+
+    // Tick from which the tasks are due (ticks before the start are not run)
+    uint64_t first = this->tick;
+
+    // Ticks slept at most in a row, so stop() is noticed even with only slow tasks
+    uint64_t max_sleep = (SCHEDULER_MAX_SLEEP_NS > this->tick_ns) ? SCHEDULER_MAX_SLEEP_NS / this->tick_ns : 1;
+
+    while (this->running.load(std::memory_order_acquire)) {
+
+        // Sleep through the ticks where nothing is due
+        uint64_t next = first + max_sleep - 1;
+
+        for (size_t i = 0; i < this->tasks.size(); i++) {
+            next = std::min(next, TaskScheduler::nextRun(this->tasks[i], first));
+        }
+
+        this->timer.waitUntil(next);
+
+        // A long sleep may have outlived the scheduler
+        if (!this->running.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        this->tick = this->timer.getIndex();
+
+        for (size_t i = 0; i < this->tasks.size(); i++) {
+
+            PeriodicTask& task = this->tasks[i];
+
+            // Ticks skipped after an overrun are not replayed, a task due in them runs once now
+            if (TaskScheduler::nextRun(task, first) > this->tick) {
+                continue;
+            }
+
+            uint64_t start = monotonicTime();
+
+            task.run();
+
+            uint64_t duration = monotonicTime() - start;
+
+            task.runs++;
+
+            if (duration > task.max_duration_ns) {
+                task.max_duration_ns = duration;
+            }
+
+        }
+
+        first = this->tick + 1;
+
+    }
+
+}
+
+
+bool TaskScheduler::start(uint64_t origin) {
+
+    if (!this->scheduler_thread.joinable()) {
+
+        this->running = true;
+
+        try {
+
+            this->scheduler_thread = std::thread(&TaskScheduler::run, this, origin);
+
+        } catch (const std::system_error& e) {
+
+            fprintf(stderr, "scheduler thread failed to start: %s\n", e.what());
+            this->running = false;
+            return false;
+
+        }
+
+    }
+
+    return true;
+
+}
+
+
+void TaskScheduler::stop() {
+
+    this->running = false;
+
+    if (this->scheduler_thread.joinable() && this->scheduler_thread.get_id() != std::this_thread::get_id()) {
+        this->scheduler_thread.join();
+    }
+
+}
+
+
+const std::vector<PeriodicTask>& TaskScheduler::getTasks() {
+
+    return this->tasks;
+
+}
+
+
+PeriodicTimer& TaskScheduler::getTimer() {
+
+    return this->timer;
+
+}
+
+
+pthread_t TaskScheduler::nativeHandle() {
+
+    return this->scheduler_thread.native_handle();
+
+}
+
+
+TaskScheduler::~TaskScheduler() {
+
+    this->stop();
+
+}
+
+
+bool setRealtimePriority(pthread_t thread, int priority) {
+
+    struct sched_param param;
+    param.sched_priority = priority;
+
+    return pthread_setschedparam(thread, SCHED_FIFO, &param) == 0;
+
+}
+
+
+bool setCpuAffinity(pthread_t thread, int cpu) {
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+
+}
+
+
+bool canLockMemory() {
+
+    struct rlimit limit;
+
+    if (geteuid() == 0) {
+        return true;
+    }
+
+    return getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY;
+
+}
+
+
+bool lockMemory() {
+
+    return mlockall(MCL_CURRENT) == 0;
+
+}
@@ -0,0 +1,194 @@
+#include "state.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+StatePublisher::StatePublisher() {
+
+    this->name[0] = '\0';
+    this->page = NULL;
+
+}
+
+
+bool StatePublisher::open(const char* name) {
+
+    this->close();
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+
+        perror("state page failed to open");
+        return false;
+
+    }
+
+    if (ftruncate(fd, sizeof(StatePage)) != 0) {
+
+        perror("state page failed to allocate");
+        ::close(fd);
+        return false;
+
+    }
+
+    void* map = mmap(NULL, sizeof(StatePage), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+
+    // The mapping keeps the segment, not the descriptor
+    ::close(fd);
+
+    if (map == MAP_FAILED) {
+
+        perror("state page failed to map");
+        return false;
+
+    }
+
+    this->page = (StatePage*) map;
+
+    // Observers of a previous run see an invalid page until the new one is ready
+    this->page->magic.store(0, std::memory_order_relaxed);
+
+    new (&this->page->state) SeqLock<ControlState>();
+
+    this->page->version = STATE_VERSION;
+    this->page->state_size = sizeof(ControlState);
+    this->page->reserved = 0;
+    this->page->magic.store(STATE_MAGIC, std::memory_order_release);
+
+    snprintf(this->name, sizeof(this->name), "%s", name);
+
+    return true;
+
+}
+
+
+bool StatePublisher::isOpen() const {
+
+    return this->page != NULL;
+
+}
+
+
+void StatePublisher::close() {
+
+    if (this->page != NULL) {
+
+        munmap(this->page, sizeof(StatePage));
+        this->page = NULL;
+
+    }
+
+    if (this->name[0] != '\0') {
+
+        shm_unlink(this->name);
+        this->name[0] = '\0';
+
+    }
+
+}
+
+
+StatePublisher::~StatePublisher() {
+
+    this->close();
+
+}
+
+
+StateReader::StateReader() {
+
+    this->page = NULL;
+
+}
+
+
+bool StateReader::open(const char* name) {
+
+    this->close();
+
+    int fd = shm_open(name, O_RDONLY, 0);
+
+    if (fd < 0) {
+
+        perror("state page failed to open");
+        return false;
+
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(StatePage)) {
+
+        fprintf(stderr, "state page too small\n");
+        ::close(fd);
+        return false;
+
+    }
+
+    void* map = mmap(NULL, sizeof(StatePage), PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+
+    if (map == MAP_FAILED) {
+
+        perror("state page failed to map");
+        return false;
+
+    }
+
+    this->page = (const StatePage*) map;
+
+    if (this->page->magic.load(std::memory_order_acquire) != STATE_MAGIC || this->page->version != STATE_VERSION || this->page->state_size != sizeof(ControlState)) {
+
+        fprintf(stderr, "invalid state page\n");
+        this->close();
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+bool StateReader::read(ControlState& state, uint64_t& seq) const {
+
+    for (int i = 0; i < STATE_READ_ATTEMPTS; i++) {
+
+        if (this->page->state.tryLoad(state, seq)) {
+            return true;
+        }
+
+        usleep(STATE_READ_RETRY_US);
+
+    }
+
+    return false;
+
+}
+
+
+void StateReader::close() {
+
+    if (this->page != NULL) {
+
+        munmap((void*) this->page, sizeof(StatePage));
+        this->page = NULL;
+
+    }
+
+}
+
+
+StateReader::~StateReader() {
+
+    this->close();
+
+}
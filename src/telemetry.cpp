@@ -0,0 +1,252 @@
+#include "telemetry.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+TelemetryRecorder::TelemetryRecorder() {
+
+    this->fd = -1;
+    this->size = 0;
+    this->header = NULL;
+    this->records = NULL;
+
+}
+
+
+bool TelemetryRecorder::open(const char* path, uint64_t capacity) {
+
+    this->close();
+
+    if (capacity == 0) {
+        return false;
+    }
+
+    this->fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (this->fd < 0) {
+
+        perror("telemetry file failed to open");
+        return false;
+
+    }
+
+    this->size = sizeof(TelemetryHeader) + capacity * sizeof(TelemetryRecord);
+
+    // Reserve the blocks now so the writes through the mapping never fail or allocate
+    int error = posix_fallocate(this->fd, 0, this->size);
+
+    if (error != 0) {
+
+        // posix_fallocate returns the error instead of setting errno
+        fprintf(stderr, "telemetry file failed to allocate: %s\n", strerror(error));
+        this->close();
+        return false;
+
+    }
+
+    void* map = mmap(NULL, this->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, 0);
+
+    if (map == MAP_FAILED) {
+
+        perror("telemetry file failed to map");
+        this->close();
+        return false;
+
+    }
+
+    this->header = (TelemetryHeader*) map;
+    this->records = (TelemetryRecord*) ((uint8_t*) map + sizeof(TelemetryHeader));
+
+    memset((void*) this->header, 0, sizeof(TelemetryHeader));
+
+    this->header->magic = TELEMETRY_MAGIC;
+    this->header->version = TELEMETRY_VERSION;
+    this->header->record_size = sizeof(TelemetryRecord);
+    this->header->capacity = capacity;
+    this->header->count.store(0, std::memory_order_release);
+
+    return true;
+
+}
+
+
+void TelemetryRecorder::flush() {
+
+    if (this->header != NULL) {
+        msync(this->header, this->size, MS_ASYNC);
+    }
+
+}
+
+
+bool TelemetryRecorder::isOpen() {
+
+    return this->header != NULL;
+
+}
+
+
+void TelemetryRecorder::close() {
+
+    if (this->header != NULL) {
+
+        msync(this->header, this->size, MS_SYNC);
+        munmap(this->header, this->size);
+
+        this->header = NULL;
+        this->records = NULL;
+
+    }
+
+    if (this->fd >= 0) {
+
+        ::close(this->fd);
+        this->fd = -1;
+
+    }
+
+}
+
+
+TelemetryRecorder::~TelemetryRecorder() {
+
+    this->close();
+
+}
+
+
+TelemetryReader::TelemetryReader() {
+
+    this->fd = -1;
+    this->size = 0;
+    this->header = NULL;
+    this->records = NULL;
+    this->first = 0;
+    this->available = 0;
+
+}
+
+
+bool TelemetryReader::open(const char* path) {
+
+    this->close();
+
+    this->fd = ::open(path, O_RDONLY);
+
+    if (this->fd < 0) {
+
+        perror("telemetry file failed to open");
+        return false;
+
+    }
+
+    struct stat st;
+
+    if (fstat(this->fd, &st) < 0 || (size_t) st.st_size < sizeof(TelemetryHeader)) {
+
+        fprintf(stderr, "telemetry file is too small\n");
+        this->close();
+        return false;
+
+    }
+
+    this->size = st.st_size;
+
+    void* map = mmap(NULL, this->size, PROT_READ, MAP_SHARED, this->fd, 0);
+
+    if (map == MAP_FAILED) {
+
+        perror("telemetry file failed to map");
+        this->close();
+        return false;
+
+    }
+
+    this->header = (const TelemetryHeader*) map;
+    this->records = (const TelemetryRecord*) ((const uint8_t*) map + sizeof(TelemetryHeader));
+
+    if (this->header->magic != TELEMETRY_MAGIC || this->header->version != TELEMETRY_VERSION ||
+        this->header->record_size != sizeof(TelemetryRecord) || this->header->capacity == 0 ||
+        this->size < sizeof(TelemetryHeader) + this->header->capacity * sizeof(TelemetryRecord)) {
+
+        fprintf(stderr, "not a telemetry file (or an incompatible version)\n");
+        this->close();
+        return false;
+
+    }
+
+    // Once the ring wrapped, the oldest record is the one after the newest
+    uint64_t written = this->header->count.load(std::memory_order_acquire);
+
+    this->available = (written < this->header->capacity) ? written : this->header->capacity;
+    this->first = written - this->available;
+
+    return true;
+
+}
+
+
+uint64_t TelemetryReader::count() const {
+
+    return this->available;
+
+}
+
+
+const TelemetryRecord& TelemetryReader::at(uint64_t index) const {
+
+    return this->records[(this->first + index) % this->header->capacity];
+
+}
+
+
+void TelemetryReader::close() {
+
+    if (this->header != NULL) {
+
+        munmap((void*) this->header, this->size);
+
+        this->header = NULL;
+        this->records = NULL;
+
+    }
+
+    if (this->fd >= 0) {
+
+        ::close(this->fd);
+        this->fd = -1;
+
+    }
+
+    this->first = 0;
+    this->available = 0;
+
+}
+
+
+TelemetryReader::~TelemetryReader() {
+
+    this->close();
+
+}
+
+
+void printTelemetryHeader(FILE* file) {
+
+    fprintf(file, "timestamp,cycle,a0,a1,a2,a3,batt,flags,logdiff,filtered,p,i,d,angle,speed\n");
+
+}
+
+
+void printTelemetryRecord(FILE* file, const TelemetryRecord& r) {
+
+    fprintf(file, "%llu,%u,%u,%u,%u,%u,%u,%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+            (unsigned long long) r.timestamp, r.cycle, r.raw[0], r.raw[1], r.raw[2], r.raw[3], r.raw[4], r.flags,
+            r.logdiff, r.filtered, r.p, r.i, r.d, r.angle, r.speed);
+
+}
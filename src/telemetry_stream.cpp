@@ -0,0 +1,444 @@
+#include "telemetry_stream.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define TELEMETRY_STREAM_TCP "tcp:"
+
+
+/**
+ * @brief Builds the socket address of "tcp:[ADDRESS:]PORT" (loopback without an address) or of a UNIX socket path.
+ * @param address The address.
+ * @param storage Receives the socket address.
+ * @param length Receives the size of the socket address.
+ * @return True if the address is valid, false otherwise.
+ */
+static bool parseAddress(const char* address, struct sockaddr_storage& storage, socklen_t& length) {
+
+    memset(&storage, 0, sizeof(storage));
+
+    if (strncmp(address, TELEMETRY_STREAM_TCP, strlen(TELEMETRY_STREAM_TCP)) != 0) {
+
+        struct sockaddr_un* local = (struct sockaddr_un*) &storage;
+
+        if (strlen(address) >= sizeof(local->sun_path)) {
+
+            fprintf(stderr, "telemetry socket path too long: %s\n", address);
+            return false;
+
+        }
+
+        local->sun_family = AF_UNIX;
+        strcpy(local->sun_path, address);
+        length = sizeof(struct sockaddr_un);
+
+        return true;
+
+    }
+
+    struct sockaddr_in* inet = (struct sockaddr_in*) &storage;
+
+    const char* host = address + strlen(TELEMETRY_STREAM_TCP);
+    const char* colon = strrchr(host, ':');
+    const char* port = (colon != NULL) ? colon + 1 : host;
+
+    char* end = NULL;
+    long number = strtol(port, &end, 10);
+
+    if (*port == '\0' || *end != '\0' || number <= 0 || number > 65535) {
+
+        fprintf(stderr, "invalid telemetry port: %s\n", address);
+        return false;
+
+    }
+
+    inet->sin_family = AF_INET;
+    inet->sin_port = htons((uint16_t) number);
+    inet->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (colon != NULL) {
+
+        char ip[INET_ADDRSTRLEN];
+
+        snprintf(ip, sizeof(ip), "%.*s", (int) (colon - host), host);
+
+        if (inet_pton(AF_INET, ip, &inet->sin_addr) != 1) {
+
+            fprintf(stderr, "invalid telemetry address: %s\n", address);
+            return false;
+
+        }
+
+    }
+
+    length = sizeof(struct sockaddr_in);
+
+    return true;
+
+}
+
+
+TelemetryServer::TelemetryServer() {
+
+    this->fd = -1;
+    this->path[0] = '\0';
+    this->dropped = 0;
+
+    for (int i = 0; i < TELEMETRY_STREAM_CLIENTS; i++) {
+        this->subscribers[i].fd = -1;
+    }
+
+}
+
+
+bool TelemetryServer::open(const char* address) {
+
+    this->close();
+
+    struct sockaddr_storage storage;
+    socklen_t length;
+
+    if (!parseAddress(address, storage, length)) {
+        return false;
+    }
+
+    this->fd = socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (this->fd < 0) {
+
+        perror("telemetry socket failed to open");
+        return false;
+
+    }
+
+    if (storage.ss_family == AF_UNIX) {
+
+        // A socket left by a previous run would make bind fail
+        unlink(address);
+        snprintf(this->path, sizeof(this->path), "%s", address);
+
+    } else {
+
+        int reuse = 1;
+        setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    }
+
+    if (bind(this->fd, (struct sockaddr*) &storage, length) < 0 || listen(this->fd, TELEMETRY_STREAM_CLIENTS) < 0) {
+
+        perror("telemetry socket failed to listen");
+        this->close();
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+void TelemetryServer::accept() {
+
+    int client;
+
+    while ((client = accept4(this->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+
+        TelemetrySubscriber* subscriber = NULL;
+
+        for (int i = 0; i < TELEMETRY_STREAM_CLIENTS && subscriber == NULL; i++) {
+
+            if (this->subscribers[i].fd < 0) {
+                subscriber = &this->subscribers[i];
+            }
+
+        }
+
+        if (subscriber == NULL) {
+
+            ::close(client);
+            continue;
+
+        }
+
+        // Frames are sent as soon as they are built
+        if (this->path[0] == '\0') {
+
+            int nodelay = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        }
+
+        // Subscribers start with the next record
+        subscriber->fd = client;
+        subscriber->cursor = this->records.count();
+        subscriber->dropped = 0;
+        subscriber->length = 0;
+        subscriber->sent = 0;
+
+    }
+
+}
+
+
+bool TelemetryServer::send(TelemetrySubscriber& subscriber) {
+
+    while (true) {
+
+        // Build the next frame once the previous one is sent
+        if (subscriber.sent == subscriber.length) {
+
+            TelemetryFrameHeader header;
+            TelemetryRecord* batch = (TelemetryRecord*) (subscriber.buffer + sizeof(TelemetryFrameHeader));
+
+            uint64_t cursor = subscriber.cursor;
+            size_t count = this->records.copy(subscriber.cursor, batch, TELEMETRY_STREAM_BATCH);
+
+            // The records the cursor skipped were overwritten before this subscriber got them
+            subscriber.dropped += (subscriber.cursor - cursor) - count;
+
+            if (count == 0) {
+                return true;
+            }
+
+            header.magic = TELEMETRY_STREAM_MAGIC;
+            header.version = TELEMETRY_STREAM_VERSION;
+            header.count = (uint16_t) count;
+            header.record_size = sizeof(TelemetryRecord);
+            header.dropped = (uint32_t) subscriber.dropped;
+            header.sequence = subscriber.cursor - count;
+
+            memcpy(subscriber.buffer, &header, sizeof(header));
+
+            this->dropped += subscriber.dropped;
+
+            subscriber.dropped = 0;
+            subscriber.length = sizeof(TelemetryFrameHeader) + count * sizeof(TelemetryRecord);
+            subscriber.sent = 0;
+
+        }
+
+        ssize_t written = ::send(subscriber.fd, subscriber.buffer + subscriber.sent, subscriber.length - subscriber.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (written < 0) {
+
+            // A full socket keeps the frame for the next call, the ring absorbs the backlog
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+        }
+
+        subscriber.sent += written;
+
+        if (subscriber.sent < subscriber.length) {
+            return true;
+        }
+
+    }
+
+}
+
+
+void TelemetryServer::drop(TelemetrySubscriber& subscriber) {
+
+    ::close(subscriber.fd);
+    subscriber.fd = -1;
+
+}
+
+
+void TelemetryServer::service() {
+
+    if (this->fd < 0) {
+        return;
+    }
+
+    this->accept();
+
+    for (int i = 0; i < TELEMETRY_STREAM_CLIENTS; i++) {
+
+        if (this->subscribers[i].fd >= 0 && !this->send(this->subscribers[i])) {
+            this->drop(this->subscribers[i]);
+        }
+
+    }
+
+}
+
+
+int TelemetryServer::getSubscribers() const {
+
+    int count = 0;
+
+    for (int i = 0; i < TELEMETRY_STREAM_CLIENTS; i++) {
+
+        if (this->subscribers[i].fd >= 0) {
+            count++;
+        }
+
+    }
+
+    return count;
+
+}
+
+
+uint64_t TelemetryServer::getDropped() const {
+
+    return this->dropped;
+
+}
+
+
+bool TelemetryServer::isOpen() const {
+
+    return this->fd >= 0;
+
+}
+
+
+void TelemetryServer::close() {
+
+    for (int i = 0; i < TELEMETRY_STREAM_CLIENTS; i++) {
+
+        if (this->subscribers[i].fd >= 0) {
+            this->drop(this->subscribers[i]);
+        }
+
+    }
+
+    if (this->fd >= 0) {
+
+        ::close(this->fd);
+        this->fd = -1;
+
+    }
+
+    if (this->path[0] != '\0') {
+
+        unlink(this->path);
+        this->path[0] = '\0';
+
+    }
+
+}
+
+
+TelemetryServer::~TelemetryServer() {
+
+    this->close();
+
+}
+
+
+TelemetryClient::TelemetryClient() {
+
+    this->fd = -1;
+
+}
+
+
+bool TelemetryClient::connect(const char* address) {
+
+    this->close();
+
+    struct sockaddr_storage storage;
+    socklen_t length;
+
+    if (!parseAddress(address, storage, length)) {
+        return false;
+    }
+
+    this->fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (this->fd < 0) {
+
+        perror("telemetry socket failed to open");
+        return false;
+
+    }
+
+    if (::connect(this->fd, (struct sockaddr*) &storage, length) < 0) {
+
+        perror("telemetry server failed to connect");
+        this->close();
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+/**
+ * @brief Reads exactly size bytes from a socket.
+ * @return False if the connection was closed or failed first.
+ */
+static bool receiveAll(int fd, void* data, size_t size) {
+
+    uint8_t* bytes = (uint8_t*) data;
+
+    while (size > 0) {
+
+        ssize_t received = recv(fd, bytes, size, 0);
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received <= 0) {
+            return false;
+        }
+
+        bytes += received;
+        size -= received;
+
+    }
+
+    return true;
+
+}
+
+
+bool TelemetryClient::receive(TelemetryFrameHeader& header, TelemetryRecord records[TELEMETRY_STREAM_BATCH]) {
+
+    if (this->fd < 0 || !receiveAll(this->fd, &header, sizeof(header))) {
+        return false;
+    }
+
+    if (header.magic != TELEMETRY_STREAM_MAGIC || header.version != TELEMETRY_STREAM_VERSION || header.record_size != sizeof(TelemetryRecord) || header.count > TELEMETRY_STREAM_BATCH) {
+
+        fprintf(stderr, "invalid telemetry frame\n");
+        return false;
+
+    }
+
+    return receiveAll(this->fd, records, header.count * sizeof(TelemetryRecord));
+
+}
+
+
+void TelemetryClient::close() {
+
+    if (this->fd >= 0) {
+
+        ::close(this->fd);
+        this->fd = -1;
+
+    }
+
+}
+
+
+TelemetryClient::~TelemetryClient() {
+
+    this->close();
+
+}
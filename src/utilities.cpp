@@ -1,6 +1,7 @@
 #include "utilities.hpp"
 
 #include <math.h>
+#include <time.h>
 
 float saturate(float value, float min, float max) {
 
@@ -20,3 +21,13 @@ float logdiff(float a, float b, float bias) {
     return log(a + bias) - log(b + bias);
 
 }
+
+
+uint64_t monotonicTime() {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+
+}
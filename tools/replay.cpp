@@ -0,0 +1,657 @@
+#include "telemetry.hpp"
+#include "picarx.hpp"
+#include "config.hpp"
+#include "pid.hpp"
+#include "filters.hpp"
+#include "utilities.hpp"
+#include "logtable.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+#define KD_FILTER_TAU_S 0.02f           // PID of the car (src/main.cpp)
+#define PID_DT_MAX_S (CONFIG_MAX_DT_US * 1e-6f)
+#define ANTI_WINDUP ANTI_WINDUP_CLAMP
+#define LOST_THRESHOLD 5.0f     // |logdiff| beyond which the line is considered lost
+#define CHUNK 16                // Candidates taken from a worker range at a time
+
+
+/**
+ * @brief One step of a recorded run, reduced to what the replay needs.
+ */
+struct Sample {
+
+    float measured;     /** Log difference seen by the car.                         */
+    float angle;        /** Steering angle applied by the car (saturated).          */
+    float dt;           /** Time to the next sample in seconds.                     */
+    float disturbance;  /** Part of the next measurement the steering did not explain. */
+
+};
+
+/**
+ * @brief A tuning evaluated by the replay, and its error metrics.
+ */
+struct Candidate {
+
+    float kp;           /** Proportional gain.                                      */
+    float ki;           /** Integral gain.                                          */
+    float kd;           /** Derivative gain.                                        */
+    float alpha;        /** Filter coefficient.                                     */
+
+    float rms;          /** RMS of the simulated log difference.                    */
+    float max;          /** Largest absolute simulated log difference.              */
+    float effort;       /** RMS of the change of steering angle between steps.      */
+    float saturated;    /** Fraction of the steps where the servo saturated.        */
+    float cost;         /** Ranking cost, rms + effort weight * effort.             */
+    bool lost;          /** Whether the simulated car lost the line.                */
+
+};
+
+/**
+ * @brief A range of values swept for one parameter.
+ */
+struct Range {
+
+    float min;          /** First value.                        */
+    float max;          /** Last value.                         */
+    int steps;          /** Number of values (1 keeps min).     */
+
+    float at(int i) const {
+        return (this->steps <= 1) ? this->min : this->min + (this->max - this->min) * i / (this->steps - 1);
+    }
+
+};
+
+/**
+ * @brief A pool running a function over an index range, with work stealing between threads.
+ *
+ * Every worker starts with an equal slice of the range and takes small chunks from the front of
+ * it. A worker whose slice is empty steals the back half of the largest remaining slice, so
+ * uneven candidates (e.g. runs that stop early when the line is lost) do not leave cores idle.
+ */
+class WorkStealingPool {
+
+    private:
+
+        /**
+         * @brief The remaining slice of a worker, guarded by its own lock.
+         */
+        struct alignas(64) Slice {
+
+            std::mutex lock;
+            size_t begin;
+            size_t end;
+
+        };
+
+        std::vector<Slice> slices;      /** One slice per worker.   */
+        std::atomic<size_t> steals;     /** Number of steals.       */
+
+        /**
+         * @brief Takes the next chunk from the front of a worker slice.
+         */
+        bool take(size_t worker, size_t& begin, size_t& end) {
+
+            Slice& slice = this->slices[worker];
+            std::lock_guard<std::mutex> guard(slice.lock);
+
+            if (slice.begin >= slice.end) {
+                return false;
+            }
+
+            begin = slice.begin;
+            end = std::min(slice.begin + CHUNK, slice.end);
+            slice.begin = end;
+
+            return true;
+
+        }
+
+        /**
+         * @brief Moves the back half of the largest other slice to a worker.
+         */
+        bool steal(size_t worker) {
+
+            while (true) {
+
+                size_t victim = worker;
+                size_t largest = 0;
+
+                for (size_t i = 0; i < this->slices.size(); i++) {
+
+                    std::lock_guard<std::mutex> guard(this->slices[i].lock);
+
+                    size_t remaining = this->slices[i].end - this->slices[i].begin;
+
+                    if (i != worker && remaining > largest) {
+                        victim = i;
+                        largest = remaining;
+                    }
+
+                }
+
+                if (victim == worker) {
+                    return false;
+                }
+
+                size_t begin;
+                size_t end;
+
+                {
+
+                    std::lock_guard<std::mutex> guard(this->slices[victim].lock);
+
+                    Slice& slice = this->slices[victim];
+
+                    // The victim may have drained its slice in the meantime, look again
+                    if (slice.end <= slice.begin) {
+                        continue;
+                    }
+
+                    end = slice.end;
+                    begin = slice.begin + (slice.end - slice.begin) / 2;
+                    slice.end = begin;
+
+                }
+
+                std::lock_guard<std::mutex> guard(this->slices[worker].lock);
+
+                this->slices[worker].begin = begin;
+                this->slices[worker].end = end;
+                this->steals++;
+
+                return true;
+
+            }
+
+        }
+
+    public:
+
+        WorkStealingPool(size_t threads) : slices(threads), steals(0) {}
+
+        /**
+         * @brief Runs a function on every index of [0, count), blocking until all are done.
+         */
+        template <typename F>
+        void run(size_t count, F function) {
+
+            size_t threads = this->slices.size();
+
+            for (size_t i = 0; i < threads; i++) {
+                this->slices[i].begin = count * i / threads;
+                this->slices[i].end = count * (i + 1) / threads;
+            }
+
+            std::vector<std::thread> workers;
+
+            for (size_t w = 0; w < threads; w++) {
+
+                workers.emplace_back([this, w, &function] {
+
+                    size_t begin;
+                    size_t end;
+
+                    do {
+
+                        while (this->take(w, begin, end)) {
+                            for (size_t i = begin; i < end; i++) {
+                                function(i);
+                            }
+                        }
+
+                    } while (this->steal(w));
+
+                });
+
+            }
+
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+
+        }
+
+        size_t getSteals() {
+            return this->steals;
+        }
+
+};
+
+
+/**
+ * @brief Prints the usage of the tool.
+ * @param name The name of the executable.
+ * @return void
+*/
+void usage(const char* name);
+
+/**
+ * @brief Parses a range argument "min:max:steps" (or a single value).
+ * @param text The argument.
+ * @param range Receives the range.
+ * @return True if the argument is valid, false otherwise.
+*/
+bool parseRange(const char* text, Range& range);
+
+/**
+ * @brief Loads a telemetry file and reconstructs the samples of the recorded run.
+ * @param path The path of the telemetry file.
+ * @param bias The log difference bias.
+ * @param samples Receives the samples.
+ * @return True if the file holds a usable run, false otherwise.
+*/
+bool loadTrace(const char* path, float bias, std::vector<Sample>& samples);
+
+/**
+ * @brief Fits the steering gain of the lateral model and stores the residual disturbance in the samples.
+ * The model is measured[k + 1] = measured[k] + gain * angle[k] * dt[k] + disturbance[k].
+ * @param samples The samples of the recorded run.
+ * @return The least squares steering gain (0 if the run has no steering).
+*/
+float fitModel(std::vector<Sample>& samples);
+
+/**
+ * @brief Applies a steering gain to the model and stores the residual disturbance in the samples.
+ * @param samples The samples of the recorded run.
+ * @param gain The steering gain.
+ * @return void
+*/
+void applyModel(std::vector<Sample>& samples, float gain);
+
+/**
+ * @brief Replays the recorded disturbance in closed loop with a candidate tuning, through the PID
+ *        of the car fed with the recorded periods.
+ * @param samples The samples of the recorded run.
+ * @param gain The steering gain of the model.
+ * @param dt The controller time step, given to the first pass as on the car.
+ * @param effort_weight The weight of the steering effort in the cost.
+ * @param candidate The tuning, receives its metrics.
+ * @return void
+*/
+void simulate(const std::vector<Sample>& samples, float gain, float dt, float effort_weight, Candidate& candidate);
+
+
+
+int main(int argc, char** argv) {
+
+    const char* path = NULL;
+
+    Range kp = { 0.0f, 20.0f, 21 };
+    Range ki = { 0.0f, 2.0f, 5 };
+    Range kd = { 0.0f, 1.0f, 5 };
+    Range alpha = { 0.1f, 1.0f, 10 };
+
+    int random_count = 0;
+    unsigned long seed = 1;
+    int threads = std::thread::hardware_concurrency();
+    int top = 20;
+    float bias = LOG_DIFF_BIAS;
+    float gain = NAN;
+    float effort_weight = 0.01f;
+
+    for (int i = 1; i < argc; i++) {
+
+        bool has_value = i + 1 < argc;
+        bool valid = true;
+
+        if (strcmp(argv[i], "--kp") == 0 && has_value) {
+            valid = parseRange(argv[++i], kp);
+        } else if (strcmp(argv[i], "--ki") == 0 && has_value) {
+            valid = parseRange(argv[++i], ki);
+        } else if (strcmp(argv[i], "--kd") == 0 && has_value) {
+            valid = parseRange(argv[++i], kd);
+        } else if (strcmp(argv[i], "--alpha") == 0 && has_value) {
+            valid = parseRange(argv[++i], alpha);
+        } else if (strcmp(argv[i], "--random") == 0 && has_value) {
+            random_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--top") == 0 && has_value) {
+            top = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bias") == 0 && has_value) {
+            bias = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--gain") == 0 && has_value) {
+            gain = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--effort-weight") == 0 && has_value) {
+            effort_weight = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+
+            usage(argv[0]);
+            return 1;
+
+        }
+
+    }
+
+    if (path == NULL) {
+
+        usage(argv[0]);
+        return 1;
+
+    }
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    std::vector<Sample> samples;
+
+    if (!loadTrace(path, bias, samples)) {
+        return 1;
+    }
+
+    // Fit the steering gain unless it was given, then extract the disturbance the run went through
+    if (isnan(gain)) {
+
+        gain = fitModel(samples);
+
+        if (gain <= 0.0f) {
+
+            fprintf(stderr, "the run does not identify the steering gain (no steering or wrong sign), use --gain\n");
+            return 1;
+
+        }
+
+    }
+
+    applyModel(samples, gain);
+
+    // Controller time step as configured on the car: the mean recorded period
+    double duration = 0.0;
+
+    for (const Sample& sample : samples) {
+        duration += sample.dt;
+    }
+
+    float dt = (float) (duration / samples.size());
+
+    // Build the candidates, a grid or uniform random draws within the ranges
+    std::vector<Candidate> candidates;
+
+    if (random_count > 0) {
+
+        std::mt19937_64 generator(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        for (int i = 0; i < random_count; i++) {
+
+            Candidate candidate = {};
+
+            candidate.kp = kp.min + (kp.max - kp.min) * unit(generator);
+            candidate.ki = ki.min + (ki.max - ki.min) * unit(generator);
+            candidate.kd = kd.min + (kd.max - kd.min) * unit(generator);
+            candidate.alpha = alpha.min + (alpha.max - alpha.min) * unit(generator);
+
+            candidates.push_back(candidate);
+
+        }
+
+    } else {
+
+        for (int a = 0; a < kp.steps; a++) {
+            for (int b = 0; b < ki.steps; b++) {
+                for (int c = 0; c < kd.steps; c++) {
+                    for (int d = 0; d < alpha.steps; d++) {
+
+                        Candidate candidate = {};
+
+                        candidate.kp = kp.at(a);
+                        candidate.ki = ki.at(b);
+                        candidate.kd = kd.at(c);
+                        candidate.alpha = alpha.at(d);
+
+                        candidates.push_back(candidate);
+
+                    }
+                }
+            }
+        }
+
+    }
+
+    fprintf(stderr, "%zu samples (%.1f s at %.1f Hz), steering gain %.5g, %zu candidates on %d threads\n",
+            samples.size(), duration, 1.0 / dt, gain, candidates.size(), threads);
+
+    WorkStealingPool pool(threads);
+
+    uint64_t start = monotonicTime();
+
+    pool.run(candidates.size(), [&](size_t i) {
+        simulate(samples, gain, dt, effort_weight, candidates[i]);
+    });
+
+    double elapsed = (monotonicTime() - start) * 1e-9;
+
+    fprintf(stderr, "evaluated in %.3f s (%.1f Msteps/s, %zu steals)\n",
+            elapsed, candidates.size() * samples.size() / elapsed * 1e-6, pool.getSteals());
+
+    // Rank the candidates that kept the line by cost
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return (a.lost != b.lost) ? b.lost : a.cost < b.cost;
+    });
+
+    printf("rank,kp,ki,kd,alpha,cost,rms,max,effort,saturated,lost\n");
+
+    for (size_t i = 0; i < candidates.size() && (int) i < top; i++) {
+
+        const Candidate& c = candidates[i];
+
+        printf("%zu,%g,%g,%g,%g,%.6g,%.6g,%.6g,%.6g,%.4f,%d\n",
+               i + 1, c.kp, c.ki, c.kd, c.alpha, c.cost, c.rms, c.max, c.effort, c.saturated, c.lost);
+
+    }
+
+    return 0;
+
+}
+
+
+void usage(const char* name) {
+
+    fprintf(stderr, "usage: %s [options] <telemetry file>\n", name);
+    fprintf(stderr, "  Replays a recorded run in closed loop and ranks PID/filter tunings (CSV on stdout).\n");
+    fprintf(stderr, "  --kp, --ki, --kd, --alpha min:max:steps   swept ranges (a single value fixes the parameter)\n");
+    fprintf(stderr, "  --random N       draw N uniform candidates within the ranges instead of a grid\n");
+    fprintf(stderr, "  --seed S         seed of the random draws (default 1)\n");
+    fprintf(stderr, "  --threads T      worker threads (default: all cores)\n");
+    fprintf(stderr, "  --top K          number of candidates printed (default 20)\n");
+    fprintf(stderr, "  --bias B         log difference bias (default %g)\n", LOG_DIFF_BIAS);
+    fprintf(stderr, "  --gain G         steering gain of the model instead of fitting it on the run (the fit\n");
+    fprintf(stderr, "                   is biased when the disturbance is slow, e.g. long curves)\n");
+    fprintf(stderr, "  --effort-weight W  weight of the steering effort in the cost (default 0.01)\n");
+
+}
+
+
+bool parseRange(const char* text, Range& range) {
+
+    float min;
+    float max;
+    int steps;
+
+    if (sscanf(text, "%f:%f:%d", &min, &max, &steps) == 3 && steps >= 1) {
+
+        range.min = min;
+        range.max = max;
+        range.steps = steps;
+        return true;
+
+    }
+
+    if (sscanf(text, "%f", &min) == 1 && strchr(text, ':') == NULL) {
+
+        range.min = min;
+        range.max = min;
+        range.steps = 1;
+        return true;
+
+    }
+
+    return false;
+
+}
+
+
+bool loadTrace(const char* path, float bias, std::vector<Sample>& samples) {
+
+    TelemetryReader reader;
+
+    if (!reader.open(path)) {
+        return false;
+    }
+
+    samples.clear();
+    samples.reserve(reader.count());
+
+    uint64_t previous = 0;
+
+    SteeringMap steering = PiCarX::steeringMap();
+
+    // Same lookup as the car, rebuilt for the requested bias
+    LogTable table(ADC_VREF / ADC_RESO * LINE_SENSOR_GAIN, bias);
+
+    for (uint64_t i = 0; i < reader.count(); i++) {
+
+        const TelemetryRecord& record = reader.at(i);
+
+        float measured = table.logdiffRaw(record.raw[ADC_IDX_A0], record.raw[ADC_IDX_A3]);
+
+        if (isnan(measured) || isinf(measured)) {
+            continue;
+        }
+
+        // The time step of the previous sample is only known once this one is read
+        if (!samples.empty()) {
+            samples.back().dt = (record.timestamp - previous) * 1e-9f;
+        }
+
+        Sample sample;
+
+        sample.measured = measured;
+        sample.angle = (record.flags & TELEMETRY_ACTUATED) ? saturate(record.angle, steering.min_angle, steering.max_angle) : 0.0f;
+        sample.dt = 0.0f;
+        sample.disturbance = 0.0f;
+
+        samples.push_back(sample);
+        previous = record.timestamp;
+
+    }
+
+    // The last sample has no successor to model
+    if (!samples.empty()) {
+        samples.pop_back();
+    }
+
+    if (samples.size() < 2) {
+
+        fprintf(stderr, "not enough valid records in %s\n", path);
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+float fitModel(std::vector<Sample>& samples) {
+
+    double num = 0.0;
+    double den = 0.0;
+
+    for (size_t i = 0; i + 1 < samples.size(); i++) {
+
+        double step = samples[i].angle * samples[i].dt;
+
+        num += (samples[i + 1].measured - samples[i].measured) * step;
+        den += step * step;
+
+    }
+
+    return (den > 0.0) ? (float) (num / den) : 0.0f;
+
+}
+
+
+void applyModel(std::vector<Sample>& samples, float gain) {
+
+    for (size_t i = 0; i + 1 < samples.size(); i++) {
+        samples[i].disturbance = samples[i + 1].measured - samples[i].measured - gain * samples[i].angle * samples[i].dt;
+    }
+
+    samples.back().disturbance = 0.0f;
+
+}
+
+
+void simulate(const std::vector<Sample>& samples, float gain, float dt, float effort_weight, Candidate& candidate) {
+
+    SteeringMap steering = PiCarX::steeringMap();
+
+    RobustPIDController pid(candidate.kp, candidate.ki, candidate.kd, steering.min_angle, steering.max_angle, PID_DT_MAX_S, KD_FILTER_TAU_S, ANTI_WINDUP);
+    FIRFilter filter(candidate.alpha, samples[0].measured);
+
+    // Start where the recorded run started, then let the candidate steer against the recorded disturbance
+    float measured = samples[0].measured;
+    float previous_angle = 0.0f;
+    float elapsed = dt;
+
+    double sum_error = 0.0;
+    double sum_effort = 0.0;
+    float max_error = 0.0f;
+    size_t saturated = 0;
+    size_t steps = 0;
+
+    candidate.lost = false;
+
+    for (const Sample& sample : samples) {
+
+        float angle = pid.pass(0.0f, filter.pass(measured), elapsed);
+
+        if (pid.isSaturated()) {
+            saturated++;
+        }
+
+        sum_error += measured * measured;
+        sum_effort += (angle - previous_angle) * (angle - previous_angle);
+        max_error = std::max(max_error, fabsf(measured));
+        steps++;
+
+        if (fabsf(measured) > LOST_THRESHOLD || isnan(measured)) {
+
+            candidate.lost = true;
+            break;
+
+        }
+
+        measured += gain * angle * sample.dt + sample.disturbance;
+        previous_angle = angle;
+        elapsed = sample.dt;
+
+    }
+
+    candidate.rms = sqrt(sum_error / steps);
+    candidate.max = max_error;
+    candidate.effort = sqrt(sum_effort / steps);
+    candidate.saturated = (float) saturated / steps;
+    candidate.cost = candidate.rms + effort_weight * candidate.effort;
+
+}
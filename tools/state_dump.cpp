@@ -0,0 +1,151 @@
+#include "state.hpp"
+#include "telemetry.hpp"
+#include "utilities.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/**
+ * @brief Prints the usage of the tool.
+ * @param name The name of the executable.
+ * @return void
+*/
+void usage(const char* name);
+
+/**
+ * @brief Prints a state, one "key: value" line per field.
+ * @param state The state.
+ * @param seq The sequence number of the state.
+ * @return void
+*/
+void print(const ControlState& state, uint64_t seq);
+
+
+
+int main(int argc, char** argv) {
+
+    const char* name = STATE_SHM;
+    double watch_hz = 0.0;
+    double max_age_ms = -1.0;
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watch_hz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-age") == 0 && i + 1 < argc) {
+            max_age_ms = atof(argv[++i]);
+        } else if (argv[i][0] == '/') {
+            name = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+
+    }
+
+    StateReader reader;
+
+    if (!reader.open(name)) {
+        return 1;
+    }
+
+    ControlState state;
+    uint64_t seq = 0;
+    bool consistent = reader.read(state, seq);
+
+    // Health check: the loop published recently (the monotonic clock is shared by every process)
+    if (max_age_ms >= 0.0) {
+
+        double age_ms = (seq != 0) ? (monotonicTime() - state.published) * 1e-6 : -1.0;
+
+        if (!consistent || seq == 0 || age_ms > max_age_ms) {
+
+            printf("stale (%s)\n", !consistent ? "writer stuck in an update" : (seq == 0) ? "never published" : "last update too old");
+            return 2;
+
+        }
+
+        printf("ok (%.1f ms old)\n", age_ms);
+        return 0;
+
+    }
+
+    if (watch_hz <= 0.0) {
+
+        if (!consistent) {
+
+            fprintf(stderr, "no consistent state, the writer is stuck in an update\n");
+            return 1;
+
+        }
+
+        print(state, seq);
+        return 0;
+
+    }
+
+    uint64_t shown = 0;
+    bool stuck = false;
+
+    while (true) {
+
+        // Reported once, the writer may come back (a new car resets the page)
+        if (!consistent && !stuck) {
+
+            fprintf(stderr, "no consistent state, the writer is stuck in an update\n");
+
+        } else if (consistent && seq != shown) {
+
+            print(state, seq);
+            printf("\n");
+            fflush(stdout);
+
+            shown = seq;
+
+        }
+
+        stuck = !consistent;
+
+        usleep((useconds_t) (1e6 / watch_hz));
+
+        consistent = reader.read(state, seq);
+
+    }
+
+    return 0;
+
+}
+
+
+void usage(const char* name) {
+
+    fprintf(stderr, "usage: %s [--watch HZ] [--max-age MS] [/segment]\n", name);
+    fprintf(stderr, "  Prints the control state published by the car in shared memory (default %s).\n", STATE_SHM);
+    fprintf(stderr, "  --watch HZ    prints every new state, polled HZ times per second\n");
+    fprintf(stderr, "  --max-age MS  health check: exit status 0 if the state is at most MS ms old, 2 otherwise\n");
+    fprintf(stderr, "                (also 2 if the car died in the middle of an update)\n");
+
+}
+
+
+void print(const ControlState& s, uint64_t seq) {
+
+    double age_ms = (seq != 0) ? (monotonicTime() - s.published) * 1e-6 : 0.0;
+
+    printf("sequence: %llu\n", (unsigned long long) seq);
+    printf("age: %.1f ms\n", age_ms);
+    printf("cycle: %llu\n", (unsigned long long) s.cycle);
+    printf("config epoch: %llu\n", (unsigned long long) s.config_epoch);
+    printf("raw: a0 %u a1 %u a2 %u a3 %u batt %u\n", s.raw[ADC_IDX_A0], s.raw[ADC_IDX_A1], s.raw[ADC_IDX_A2], s.raw[ADC_IDX_A3], s.raw[ADC_IDX_BATT]);
+    printf("battery: %.2f V\n", s.battery);
+    printf("logdiff: %.6g (filtered %.6g)\n", s.logdiff, s.filtered);
+    printf("pid: p %.6g i %.6g d %.6g\n", s.p, s.i, s.d);
+    printf("command: angle %.2f speed %.2f (%s)\n", s.angle, s.speed, (s.flags & TELEMETRY_ACTUATED) ? "actuated" : "held");
+    printf("step: %.1f us\n", s.step_ns * 1e-3);
+    printf("periods: %llu, %llu missed\n", (unsigned long long) s.cycles, (unsigned long long) s.missed);
+    printf("period: %.1f us mean, %.1f us jitter, %.1f us max lateness\n", s.mean_period_ns * 1e-3, s.jitter_ns * 1e-3, s.max_lateness_ns * 1e-3);
+
+}
@@ -0,0 +1,140 @@
+#include "telemetry.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+
+/**
+ * @brief Prints the usage of the tool.
+ * @param name The name of the executable.
+ * @return void
+*/
+void usage(const char* name);
+
+/**
+ * @brief Prints a summary of the recording (duration, rate and gaps between records).
+ * @param reader The opened telemetry file.
+ * @return void
+*/
+void summary(const TelemetryReader& reader);
+
+/**
+ * @brief Prints the records as CSV, oldest first.
+ * @param reader The opened telemetry file.
+ * @param first The index of the first record to print.
+ * @return void
+*/
+void csv(const TelemetryReader& reader, uint64_t first);
+
+
+
+int main(int argc, char** argv) {
+
+    const char* path = NULL;
+    bool print_summary = false;
+    uint64_t last = 0;
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--summary") == 0) {
+            print_summary = true;
+        } else if (strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+            last = strtoull(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+
+    }
+
+    if (path == NULL) {
+
+        usage(argv[0]);
+        return 1;
+
+    }
+
+    TelemetryReader reader;
+
+    if (!reader.open(path)) {
+        return 1;
+    }
+
+    if (print_summary) {
+
+        summary(reader);
+
+    } else {
+
+        uint64_t first = (last > 0 && last < reader.count()) ? reader.count() - last : 0;
+
+        csv(reader, first);
+
+    }
+
+    return 0;
+
+}
+
+
+void usage(const char* name) {
+
+    fprintf(stderr, "usage: %s [--summary] [--last N] <telemetry file>\n", name);
+    fprintf(stderr, "  Prints the records as CSV (oldest first), or a summary of the recording.\n");
+
+}
+
+
+void summary(const TelemetryReader& reader) {
+
+    uint64_t count = reader.count();
+
+    printf("records: %llu\n", (unsigned long long) count);
+
+    if (count < 2) {
+        return;
+    }
+
+    const TelemetryRecord& first = reader.at(0);
+    const TelemetryRecord& last = reader.at(count - 1);
+
+    double duration = (last.timestamp - first.timestamp) * 1e-9;
+
+    uint64_t actuated = 0;
+    uint64_t max_gap = 0;
+
+    for (uint64_t i = 0; i < count; i++) {
+
+        const TelemetryRecord& record = reader.at(i);
+
+        if (record.flags & TELEMETRY_ACTUATED) {
+            actuated++;
+        }
+
+        if (i > 0 && record.timestamp - reader.at(i - 1).timestamp > max_gap) {
+            max_gap = record.timestamp - reader.at(i - 1).timestamp;
+        }
+
+    }
+
+    printf("cycles: %u to %u\n", first.cycle, last.cycle);
+    printf("duration: %.3f s\n", duration);
+    printf("rate: %.1f Hz\n", (count - 1) / duration);
+    printf("max gap: %.3f ms\n", max_gap * 1e-6);
+    printf("actuated: %llu\n", (unsigned long long) actuated);
+
+}
+
+
+void csv(const TelemetryReader& reader, uint64_t first) {
+
+    printTelemetryHeader(stdout);
+
+    for (uint64_t i = first; i < reader.count(); i++) {
+        printTelemetryRecord(stdout, reader.at(i));
+    }
+
+}
@@ -0,0 +1,119 @@
+#include "telemetry_stream.hpp"
+#include "gnuplot.hpp"
+#include "utilities.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+
+#define PLOT_POINTS 100             // Same window as the plot of the car (src/main.cpp)
+#define PLOT_PERIOD_NS 100000000    // Redraw rate of the plot
+
+
+/**
+ * @brief Prints the usage of the tool.
+ * @param name The name of the executable.
+ * @return void
+*/
+void usage(const char* name);
+
+
+
+int main(int argc, char** argv) {
+
+    const char* address = NULL;
+    bool plotting = false;
+    uint64_t limit = 0;
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--plot") == 0) {
+            plotting = true;
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            limit = strtoull(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && address == NULL) {
+            address = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+
+    }
+
+    if (address == NULL) {
+
+        usage(argv[0]);
+        return 1;
+
+    }
+
+    TelemetryClient client;
+
+    if (!client.connect(address)) {
+        return 1;
+    }
+
+    GNUPlot* plot = NULL;
+
+    if (plotting) {
+        plot = new GNUPlot("Steering Angle", "Log Difference", -5.0f, 5.0f, PLOT_POINTS, 0.01, false);
+    } else {
+        printTelemetryHeader(stdout);
+    }
+
+    TelemetryFrameHeader header;
+    TelemetryRecord records[TELEMETRY_STREAM_BATCH];
+
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    uint64_t drawn = 0;
+
+    while ((limit == 0 || received < limit) && client.receive(header, records)) {
+
+        if (header.dropped > 0) {
+
+            fprintf(stderr, "dropped %u records before record %llu\n", header.dropped, (unsigned long long) header.sequence);
+            dropped += header.dropped;
+
+        }
+
+        for (int i = 0; i < header.count && (limit == 0 || received < limit); i++, received++) {
+
+            if (plot != NULL) {
+                plot->add(records[i].logdiff);
+            } else {
+                printTelemetryRecord(stdout, records[i]);
+            }
+
+        }
+
+        if (plot != NULL && monotonicTime() - drawn >= PLOT_PERIOD_NS) {
+
+            plot->refresh();
+            drawn = monotonicTime();
+
+        }
+
+        fflush(stdout);
+
+    }
+
+    fprintf(stderr, "received %llu records, dropped %llu\n", (unsigned long long) received, (unsigned long long) dropped);
+
+    if (plot != NULL) {
+        delete plot;
+    }
+
+    return 0;
+
+}
+
+
+void usage(const char* name) {
+
+    fprintf(stderr, "usage: %s [--plot] [--count N] <socket path | tcp:PORT | tcp:ADDRESS:PORT>\n", name);
+    fprintf(stderr, "  Subscribes to the telemetry stream of the car and prints the records as CSV,\n");
+    fprintf(stderr, "  or plots the log difference with gnuplot.\n");
+
+}